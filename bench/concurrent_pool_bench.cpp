@@ -0,0 +1,98 @@
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "basics.h"
+#include "concurrent_memory_pool.h"
+#include "memory_pool.h"
+#include "timer.h"
+
+// Contention of ConcurrentMemoryPool against a MemoryPool behind a mutex, from 1 to 16 threads.
+// Every thread allocates a batch then frees it, over and over, in the same pool.
+
+static const u32 OPERATION_COUNT = 1 << 20; // per thread, an allocation and a free each
+static const u32 BATCH_SIZE      = 64;
+
+struct BenchElement
+{
+    u32 id;
+    f32 values[7];
+};
+
+struct LockedPool
+{
+    MemoryPool<BenchElement> pool;
+    std::mutex mutex;
+};
+
+static void run_concurrent( ConcurrentMemoryPool<BenchElement>& pool, u32 thread_index )
+{
+    PoolHandle handles[BATCH_SIZE];
+    for( u32 op = 0; op < OPERATION_COUNT; op += BATCH_SIZE )
+    {
+        for( u32 i = 0; i < BATCH_SIZE; ++i )
+            pool.Instantiate( handles[i] )->id = thread_index;
+        for( u32 i = 0; i < BATCH_SIZE; ++i )
+            pool.DestroyByHandle( handles[i] );
+    }
+}
+
+static void run_locked( LockedPool& locked, u32 thread_index )
+{
+    u32 indices[BATCH_SIZE];
+    for( u32 op = 0; op < OPERATION_COUNT; op += BATCH_SIZE )
+    {
+        for( u32 i = 0; i < BATCH_SIZE; ++i )
+        {
+            std::lock_guard<std::mutex> lock( locked.mutex );
+            locked.pool.Instantiate( indices[i] )->id = thread_index;
+        }
+        for( u32 i = 0; i < BATCH_SIZE; ++i )
+        {
+            std::lock_guard<std::mutex> lock( locked.mutex );
+            locked.pool.DestroyByIndex( indices[i] );
+        }
+    }
+}
+
+// returns the nanoseconds per allocation and free pair, over all the threads
+template<typename Pool, typename F>
+static f64 measure( Pool& pool, u32 thread_count, F run )
+{
+    std::atomic<bool> start { false };
+    std::vector<std::thread> threads;
+    for( u32 i = 0; i < thread_count; ++i )
+    {
+        threads.emplace_back( [&, i]() {
+            while( !start.load( std::memory_order_acquire ) )
+                std::this_thread::yield();
+            run( pool, i );
+        } );
+    }
+
+    Timer timer;
+    start.store( true, std::memory_order_release );
+    for( auto& thread : threads )
+        thread.join();
+    timer.Tick();
+
+    return timer.Elapsed() * 1e9 / ( (f64)OPERATION_COUNT * thread_count );
+}
+
+int main()
+{
+    println( "threads | concurrent ns/op | mutex ns/op | concurrent blobs" );
+    for( u32 thread_count : { 1u, 2u, 4u, 8u, 16u } )
+    {
+        ConcurrentMemoryPool<BenchElement> concurrent_pool;
+        f64 concurrent_time = measure( concurrent_pool, thread_count, run_concurrent );
+
+        LockedPool locked_pool;
+        f64 locked_time = measure( locked_pool, thread_count, run_locked );
+
+        println( "% | % | % | %", thread_count, concurrent_time, locked_time, concurrent_pool.GetStats().blob_count );
+    }
+
+    return 0;
+}
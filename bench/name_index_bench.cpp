@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "basics.h"
+#include "memory_pool.h"
+#include "name_index.h"
+#include "timer.h"
+
+// Name lookups of the resource pools: the NameIndex against the pool walk comparing
+// std::string the find functions used before, at 1k and 10k resources.
+// Startup is the load pattern, every resource looks its name up before being added.
+
+static const u32 LINEAR_LOOKUP_COUNT = 1000; // the walk is too slow to look every name up
+
+struct BenchResource
+{
+    std::string name;
+};
+
+static volatile u64 s_sink; // keeps the lookups from being optimized out
+
+static BenchResource* find_linear( MemoryPool<BenchResource>& pool, const std::string& name )
+{
+    for( auto resource : pool )
+    {
+        if( resource->name == name )
+            return resource;
+    }
+    return nullptr;
+}
+
+static BenchResource* find_indexed( const NameIndex& index, const std::string& name )
+{
+    return static_cast<BenchResource*>( index.Find( hash_name( name.c_str(), (u32)name.size() ), [&]( void* value ) {
+        return static_cast<BenchResource*>( value )->name == name;
+    } ) );
+}
+
+static void run( u32 resource_count )
+{
+    std::vector<std::string> names( resource_count );
+    for( u32 i = 0; i < resource_count; ++i )
+    {
+        char buffer[64];
+        snprintf( buffer, sizeof(buffer), "textures/material_%05u_albedo.png", i );
+        names[i] = buffer;
+    }
+
+    Timer timer;
+    MemoryPool<BenchResource> linear_pool;
+    for( auto& name : names )
+    {
+        if( find_linear( linear_pool, name ) == nullptr )
+            linear_pool.Instantiate()->name = name;
+    }
+    timer.Tick();
+    f64 linear_startup = timer.Elapsed() * 1000.0;
+
+    MemoryPool<BenchResource> indexed_pool;
+    NameIndex index;
+    for( auto& name : names )
+    {
+        if( find_indexed( index, name ) == nullptr )
+        {
+            BenchResource* resource = indexed_pool.Instantiate();
+            resource->name = name;
+            index.Insert( hash_name( name.c_str(), (u32)name.size() ), resource );
+        }
+    }
+    timer.Tick();
+    f64 indexed_startup = timer.Elapsed() * 1000.0;
+
+    // strided so the linear lookups are spread over the whole pool
+    u64 found = 0;
+    u32 stride = resource_count / LINEAR_LOOKUP_COUNT;
+    timer.Tick();
+    for( u32 i = 0; i < LINEAR_LOOKUP_COUNT; ++i )
+        found += find_linear( linear_pool, names[ ( i * stride ) % resource_count ] ) != nullptr;
+    timer.Tick();
+    f64 linear_lookup = timer.Elapsed() * 1e9 / LINEAR_LOOKUP_COUNT;
+
+    for( auto& name : names )
+        found += find_indexed( index, name ) != nullptr;
+    timer.Tick();
+    f64 indexed_lookup = timer.Elapsed() * 1e9 / resource_count;
+
+    s_sink = found;
+    println( "% | % | % | % | %", resource_count, linear_startup, indexed_startup, linear_lookup, indexed_lookup );
+}
+
+int main()
+{
+    println( "resources | walk startup ms | index startup ms | walk lookup ns | index lookup ns" );
+    for( u32 resource_count : { 1000u, 10000u } )
+        run( resource_count );
+
+    return 0;
+}
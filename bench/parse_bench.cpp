@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string>
+
+#include "basics.h"
+#include "file_parser.h"
+#include "resource_file_cache.h"
+#include "text_scanner.h"
+#include "timer.h"
+
+// Throughput of parse_resource_file on multi-megabyte shader files: the COPY and MAPPED
+// modes with each text scanner, then a hit in the parse cache. The file is in the page
+// cache after the first parse, so this times the parsing and not the disk.
+
+static const char* BENCH_FILE_PATH = "parse_bench.glsl";
+static const u64   BENCH_BYTES     = 256ull * 1024 * 1024; // parsed per measure, whatever the file size
+
+static volatile u64 s_sink; // keeps the parses from being optimized out
+
+static const char* s_block_text =
+    "uniform mat4 model;\n"
+    "uniform mat4 view_projection;\n"
+    "in vec3 position; // object space\n"
+    "out vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = view_projection * model * vec4( position, 1.0 );\n"
+    "    color = vec4( 1.0, 0.5, 0.25, 1.0 );\n"
+    "}\n";
+
+static u64 write_bench_file( u64 size )
+{
+    FILE* file = fopen( BENCH_FILE_PATH, "wb" );
+    assert( file != nullptr, "Can't write the benchmark input." );
+
+    u64 written = 0;
+    for( u32 block = 0; written < size; ++block )
+    {
+        written += fprintf( file, ":%s_%u\n", block % 2 == 0 ? "vertex" : "fragment", block );
+        for( u32 i = 0; i < 8; ++i )
+            written += fprintf( file, "%s", s_block_text );
+    }
+    fclose( file );
+    return written;
+}
+
+// returns MB/s
+static f64 measure( ResourceFileMode mode, u64 file_size )
+{
+    u32 iteration_count = (u32)( ( BENCH_BYTES + file_size - 1 ) / file_size );
+
+    u64 block_count = 0;
+    Timer timer;
+    for( u32 i = 0; i < iteration_count; ++i )
+    {
+        ResourceFile file = parse_resource_file( BENCH_FILE_PATH, mode );
+        assert( file.is_valid, "The benchmark input didn't parse." );
+        block_count += file.blocks.size();
+    }
+    timer.Tick();
+
+    s_sink = block_count;
+    return (f64)file_size * iteration_count / ( 1024.0 * 1024.0 ) / timer.Elapsed();
+}
+
+int main()
+{
+    println( "file MB | mode | MB/s" );
+    for( u64 size_mb : { 4ull, 16ull } )
+    {
+        u64 file_size = write_bench_file( size_mb * 1024 * 1024 );
+        u32 file_mb = (u32)size_mb;
+
+        set_resource_file_cache_enabled( false );
+        println( "% | copy | %", file_mb, measure( ResourceFileMode::COPY, file_size ) );
+
+        for( TextScanIsa isa : { TextScanIsa::SCALAR, TextScanIsa::SSE2, TextScanIsa::AVX2 } )
+        {
+            if( set_text_scan_isa( isa ) != isa )
+                continue;
+
+            static const char* isa_names[] = { "mapped scalar", "mapped sse2", "mapped avx2" };
+            println( "% | % | %", file_mb, isa_names[ (u32)isa ], measure( ResourceFileMode::MAPPED, file_size ) );
+        }
+
+        // the first parse writes the entry, the measured ones only map it
+        set_resource_file_cache_enabled( true );
+        parse_resource_file( BENCH_FILE_PATH, ResourceFileMode::MAPPED );
+        println( "% | cache hit | %", file_mb, measure( ResourceFileMode::MAPPED, file_size ) );
+    }
+
+    remove( BENCH_FILE_PATH );
+    return 0;
+}
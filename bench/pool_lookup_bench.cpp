@@ -0,0 +1,77 @@
+#include <random>
+#include <vector>
+
+#include "basics.h"
+#include "memory_pool.h"
+#include "timer.h"
+
+// Cost of the MemoryPool lookups from 1k to 1M live elements, it should stay flat.
+// The lookups are in a random order so each one is a cache miss like in a real frame.
+
+static const u32 LOOKUP_COUNT = 1 << 22;
+
+static volatile u64 s_sink; // keeps the lookups from being optimized out
+
+struct BenchElement
+{
+    u32 id;
+    f32 values[15];
+};
+
+static f64 to_ns_per_lookup( Timer& timer )
+{
+    timer.Tick();
+    return timer.Elapsed() * 1e9 / LOOKUP_COUNT;
+}
+
+static void run( u32 element_count, const MemoryPoolConfig& config, const char* mode )
+{
+    MemoryPool<BenchElement> pool( config );
+
+    std::vector<u32> indices( element_count );
+    std::vector<BenchElement*> elements( element_count );
+    std::vector<PoolHandle> handles( element_count );
+    for( u32 i = 0; i < element_count; ++i )
+    {
+        elements[i] = pool.Instantiate( indices[i] );
+        elements[i]->id = i;
+        handles[i] = pool.HandleOf( elements[i] );
+    }
+
+    std::vector<u32> order( LOOKUP_COUNT );
+    std::mt19937 rng( 42 );
+    for( auto& i : order )
+        i = rng() % element_count;
+
+    u64 sum = 0;
+    Timer timer;
+    for( u32 i : order )
+        sum += pool.Get( indices[i] )->id;
+    f64 get_time = to_ns_per_lookup( timer );
+
+    for( u32 i : order )
+        sum += pool.IndexOf( elements[i] );
+    f64 index_of_time = to_ns_per_lookup( timer );
+
+    for( u32 i : order )
+        sum += pool.TryGet( handles[i] )->id;
+    f64 try_get_time = to_ns_per_lookup( timer );
+
+    s_sink = sum;
+    println( "% | % | % | % | %", mode, element_count, get_time, index_of_time, try_get_time );
+}
+
+int main()
+{
+    MemoryPoolConfig reserved_config;
+    reserved_config.reserve_size = 256ull * 1024 * 1024;
+
+    println( "mode | elements | Get ns | IndexOf ns | TryGet ns" );
+    for( u32 element_count : { 1000u, 10000u, 100000u, 1000000u } )
+    {
+        run( element_count, MemoryPoolConfig(), "heap" );
+        run( element_count, reserved_config, "reserved" );
+    }
+
+    return 0;
+}
@@ -15,6 +15,10 @@
 #include "timer.h"
 #include "input_state.h"
 #include "resource_pool.h"
+#include "resource_budget.h"
+#include "asset_archive.h"
+#include "resource_dependencies.h"
+#include "string_table.h"
 #include "entity.h"
 
 struct Appdata;
@@ -55,16 +59,25 @@ struct Metadata
 
 struct GlobalStore
 {
-    MemoryPool<Material>       material_pool = {};
+    StringTable                strings;
 
-    MemoryPool<ResourceSource> resource_sources_pool = {};
+    // reserved like the resource pools, IndexOf and HandleOf stay a division, see FindBlob
+    MemoryPool<Material>       material_pool { MemoryPoolConfig { RESOURCE_POOL_RESERVE_SIZE, false } };
+
+    MemoryPool<ResourceSource> resource_sources_pool { MemoryPoolConfig { RESOURCE_POOL_RESERVE_SIZE, false } };
+    NameIndex                  resource_sources_names = {};
     ResourcePool               resource_pool = {};
+    ResourceBudget             resource_budget = {};
+    AssetArchive               asset_archive = {};
+    ResourceDependencies       resource_dependencies = {};
 };
 
 struct ImguiInfo
 {
     Texture* texture = nullptr;
     Shader* shader  = nullptr;
+
+    StringId font_atlas_param = INVALID_STRING_ID;
 };
 
 struct TestData
@@ -96,6 +109,8 @@ struct AppState
     Timer global_timer = {};
     int   global_frame_count = 0;
 
+    f64   pool_stats_sample_time = 0;
+
     Shader* immediate_default_shader = nullptr;
 };
 
@@ -0,0 +1,276 @@
+#include "asset_archive.h"
+
+#include <fstream>
+#include <string.h>
+
+#include "basics.h"
+#include "dll.h"
+#include "texture.h"
+#include "mesh.h"
+
+static AssetArchive& get_archive()
+{
+    return get_dll_appdata().global_store.asset_archive;
+}
+
+static u64 align_offset( u64 offset )
+{
+    return ( offset + ASSET_ARCHIVE_ALIGNMENT - 1 ) & ~(u64)( ASSET_ARCHIVE_ALIGNMENT - 1 );
+}
+
+static const char* get_archive_string( const AssetArchive& archive, u32 offset )
+{
+    auto header = reinterpret_cast<const ArchiveHeader*>( archive.file.data );
+    return reinterpret_cast<const char*>( archive.file.data + header->strings_offset + offset );
+}
+
+static const ArchiveEntry* get_archive_entries( const AssetArchive& archive )
+{
+    return reinterpret_cast<const ArchiveEntry*>( archive.file.data + sizeof(ArchiveHeader) );
+}
+
+// the loaders use the data in place from the params, it has to hold all of it
+static bool is_entry_data_valid( const ArchiveEntry& entry )
+{
+    switch( entry.kind )
+    {
+        case ArchiveEntryKind::SHADER:
+            return true;
+        case ArchiveEntryKind::TEXTURE:
+            // divided by the channels, width * height * channels could overflow
+            return entry.params[2] >= 1 && entry.params[2] <= 4
+                && entry.data_size / entry.params[2] >= (u64)entry.params[0] * entry.params[1];
+        case ArchiveEntryKind::MESH:
+            return entry.data_size == (u64)entry.params[0] * sizeof(Vertex) + (u64)entry.params[1] * sizeof(uint);
+    }
+    return false;
+}
+
+static bool validate_archive( const MappedFile& file )
+{
+    if( file.size < sizeof(ArchiveHeader) )
+        return false;
+
+    auto header = reinterpret_cast<const ArchiveHeader*>( file.data );
+    if( header->magic != ASSET_ARCHIVE_MAGIC || header->version != ASSET_ARCHIVE_VERSION )
+        return false;
+
+    u64 entries_end = sizeof(ArchiveHeader) + (u64)header->entry_count * sizeof(ArchiveEntry);
+    if( entries_end > file.size || header->strings_offset < entries_end || header->strings_offset > file.size )
+        return false;
+
+    auto entries = reinterpret_cast<const ArchiveEntry*>( file.data + sizeof(ArchiveHeader) );
+    u64 strings_size = file.size - header->strings_offset;
+    for( u32 i = 0; i < header->entry_count; ++i )
+    {
+        const ArchiveEntry& entry = entries[i];
+        if( (u64)entry.path_offset + entry.path_length > strings_size || (u64)entry.name_offset + entry.name_length > strings_size )
+            return false;
+        if( entry.data_offset % ASSET_ARCHIVE_ALIGNMENT != 0 || entry.data_offset > file.size || entry.data_size > file.size - entry.data_offset )
+            return false;
+        if( !is_entry_data_valid( entry ) )
+            return false;
+    }
+    return true;
+}
+
+bool open_asset_archive( const char* path )
+{
+    auto& archive = get_archive();
+    if( archive.file.data != nullptr )
+        return true;
+
+    if( !map_file( path, archive.file ) )
+        return false;
+
+    if( !validate_archive( archive.file ) )
+    {
+        println( "WARNING: % isn't a valid asset archive, loose files are used.", path );
+        unmap_file( archive.file );
+        return false;
+    }
+
+    auto header  = reinterpret_cast<const ArchiveHeader*>( archive.file.data );
+    auto entries = get_archive_entries( archive );
+    for( u32 i = 0; i < header->entry_count; ++i )
+    {
+        const ArchiveEntry& entry = entries[i];
+        archive.entries.Insert( hash_name( get_archive_string( archive, entry.path_offset ), entry.path_length ), const_cast<ArchiveEntry*>( &entry ) );
+    }
+
+    println( "[INFO]: Asset archive % opened, % entries.", path, header->entry_count );
+    return true;
+}
+
+void close_asset_archive()
+{
+    auto& archive = get_archive();
+    archive.entries.Clear();
+    unmap_file( archive.file );
+}
+
+const ArchiveEntry* find_archive_entry( const char* path, ArchiveEntryKind kind )
+{
+    auto& archive = get_archive();
+    if( archive.file.data == nullptr )
+        return nullptr;
+
+    u32 length = (u32)strlen( path );
+    auto entry = static_cast<const ArchiveEntry*>( archive.entries.Find( hash_name( path, length ), [&]( void* value ) {
+        auto candidate = static_cast<const ArchiveEntry*>( value );
+        return candidate->kind == kind && candidate->path_length == length
+            && memcmp( get_archive_string( archive, candidate->path_offset ), path, length ) == 0;
+    } ) );
+
+    // @Note: One stat per load, it keeps hot reloading working on packed assets.
+    u64 size, mtime;
+    if( entry != nullptr && get_file_info( path, size, mtime ) && ( size != entry->source_size || mtime != entry->source_mtime ) )
+        return nullptr;
+
+    return entry;
+}
+
+const u8* get_archive_data( const ArchiveEntry* entry )
+{
+    return get_archive().file.data + entry->data_offset;
+}
+
+std::string get_archive_entry_name( const ArchiveEntry* entry )
+{
+    return std::string( get_archive_string( get_archive(), entry->name_offset ), entry->name_length );
+}
+
+static bool has_extension( const std::string& file, const char* extension )
+{
+    size_t length = strlen( extension );
+    return file.size() >= length && _stricmp( file.c_str() + file.size() - length, extension ) == 0;
+}
+
+static ArchiveEntryKind get_entry_kind( const std::string& file )
+{
+    if( has_extension( file, ".glsl" ) )
+        return ArchiveEntryKind::SHADER;
+    if( has_extension( file, ".png" ) || has_extension( file, ".jpg" ) || has_extension( file, ".tga" ) || has_extension( file, ".bmp" ) )
+        return ArchiveEntryKind::TEXTURE;
+    return ArchiveEntryKind::MESH;
+}
+
+struct PackedEntry
+{
+    ArchiveEntry    entry;
+    std::vector<u8> data;
+};
+
+static bool pack_entry( const std::string& file, PackedEntry& packed, std::string& strings )
+{
+    ArchiveEntry& entry = packed.entry;
+    if( !get_file_info( file.c_str(), entry.source_size, entry.source_mtime ) )
+    {
+        println( "Error: Can't pack %, the file doesn't exist.", file.c_str() );
+        return false;
+    }
+
+    entry.kind        = get_entry_kind( file );
+    entry.path_offset = (u32)strings.size();
+    entry.path_length = (u32)file.size();
+    strings += file;
+
+    switch( entry.kind )
+    {
+        case ArchiveEntryKind::SHADER:
+        {
+            std::ifstream reader( file, std::ios::binary );
+            packed.data.assign( std::istreambuf_iterator<char>( reader ), std::istreambuf_iterator<char>() );
+            break;
+        }
+        case ArchiveEntryKind::TEXTURE:
+        {
+            DecodedTexture decoded;
+            if( !decode_texture( file.c_str(), decoded ) )
+            {
+                println( "Error: Can't pack %, the image can't be decoded.", file.c_str() );
+                return false;
+            }
+
+            entry.params[0] = (u32)decoded.width;
+            entry.params[1] = (u32)decoded.height;
+            entry.params[2] = (u32)decoded.channels;
+            packed.data.assign( decoded.data, decoded.data + (size_t)decoded.width * decoded.height * decoded.channels );
+            free_decoded_texture( decoded );
+            break;
+        }
+        case ArchiveEntryKind::MESH:
+        {
+            MeshDef def;
+            std::string name;
+            if( !decode_mesh( file.c_str(), def, name ) )
+                return false;
+
+            entry.name_offset = (u32)strings.size();
+            entry.name_length = (u32)name.size();
+            strings += name;
+
+            entry.params[0] = def.vertex_count;
+            entry.params[1] = def.index_count;
+
+            size_t vertices_size = def.vertex_count * sizeof(Vertex);
+            size_t indices_size  = def.index_count * sizeof(uint);
+            packed.data.resize( vertices_size + indices_size );
+            memcpy( packed.data.data(), def.vertices, vertices_size );
+            memcpy( packed.data.data() + vertices_size, def.indices, indices_size );
+
+            delete[] def.vertices;
+            delete[] def.indices;
+            break;
+        }
+    }
+
+    entry.data_size = packed.data.size();
+    return true;
+}
+
+bool pack_asset_archive( const char* archive_path, const std::vector<std::string>& files )
+{
+    std::vector<PackedEntry> packed( files.size() );
+    std::string strings;
+    for( size_t i = 0; i < files.size(); ++i )
+    {
+        if( !pack_entry( files[i], packed[i], strings ) )
+            return false;
+    }
+
+    ArchiveHeader header;
+    header.entry_count    = (u32)packed.size();
+    header.strings_offset = (u32)( sizeof(ArchiveHeader) + packed.size() * sizeof(ArchiveEntry) );
+
+    u64 offset = align_offset( header.strings_offset + strings.size() );
+    for( auto& entry : packed )
+    {
+        entry.entry.data_offset = offset;
+        offset = align_offset( offset + entry.data.size() );
+    }
+
+    std::ofstream writer( archive_path, std::ios::binary | std::ios::trunc );
+    if( !writer.is_open() )
+    {
+        println( "Error: Can't write the asset archive %.", archive_path );
+        return false;
+    }
+
+    static const char padding[ ASSET_ARCHIVE_ALIGNMENT ] = {};
+    writer.write( reinterpret_cast<const char*>( &header ), sizeof(header) );
+    for( auto& entry : packed )
+        writer.write( reinterpret_cast<const char*>( &entry.entry ), sizeof(ArchiveEntry) );
+    writer.write( strings.data(), strings.size() );
+
+    u64 written = header.strings_offset + strings.size();
+    for( auto& entry : packed )
+    {
+        writer.write( padding, entry.entry.data_offset - written );
+        writer.write( reinterpret_cast<const char*>( entry.data.data() ), entry.data.size() );
+        written = entry.entry.data_offset + entry.data.size();
+    }
+
+    println( "[INFO]: Packed % files in %, % KB.", (u32)packed.size(), archive_path, (u32)( written / 1024 ) );
+    return writer.good();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "basic_types.h"
+#include "mapped_file.h"
+#include "name_index.h"
+
+#define ASSET_ARCHIVE_PATH      "datas/assets.pak"
+#define ASSET_ARCHIVE_MAGIC     0x52414c48 // "HLAR"
+#define ASSET_ARCHIVE_VERSION   2          // 2: source_mtime comes from get_file_info
+#define ASSET_ARCHIVE_ALIGNMENT 16         // every data block starts aligned, Vertex arrays are used in place
+
+// Archive layout: ArchiveHeader | ArchiveEntry[entry_count] | strings | aligned data blocks.
+// Offsets are from the start of the archive. Data is stored ready to use:
+// shaders as their text, textures as decoded pixels, meshes as Vertex[] followed by uint[].
+enum class ArchiveEntryKind : u32
+{
+    SHADER,
+    TEXTURE,
+    MESH,
+};
+
+struct ArchiveHeader
+{
+    u32 magic          = ASSET_ARCHIVE_MAGIC;
+    u32 version        = ASSET_ARCHIVE_VERSION;
+    u32 entry_count    = 0;
+    u32 strings_offset = 0;
+};
+
+struct ArchiveEntry
+{
+    ArchiveEntryKind kind = ArchiveEntryKind::SHADER;
+    u32 path_offset = 0; // source path the loaders ask for, in the strings
+    u32 path_length = 0;
+    u32 name_offset = 0; // resource name when it doesn't come from the path (meshes)
+    u32 name_length = 0;
+    u32 params[3]   = {}; // texture: width, height, channels. mesh: vertex_count, index_count
+
+    u64 data_offset = 0;
+    u64 data_size   = 0;
+
+    // the loose file is used instead if it changed since it was packed
+    u64 source_size  = 0;
+    u64 source_mtime = 0;
+};
+
+// Lives in the GlobalStore: resources point into the mapping, it has to survive dll reloads.
+struct AssetArchive
+{
+    MappedFile file;
+    NameIndex  entries; // ArchiveEntry by hash of the path
+};
+
+bool open_asset_archive( const char* path ); // false if there is no valid archive, loose files are used then
+void close_asset_archive();
+
+// nullptr if the path isn't packed with this kind or if its loose file is newer
+const ArchiveEntry* find_archive_entry( const char* path, ArchiveEntryKind kind );
+const u8*   get_archive_data( const ArchiveEntry* entry );
+std::string get_archive_entry_name( const ArchiveEntry* entry );
+
+// Offline packing: decodes the files and writes them in one archive.
+// The kind comes from the extension, .glsl is a shader, image formats are textures, the rest meshes.
+bool pack_asset_archive( const char* archive_path, const std::vector<std::string>& files );
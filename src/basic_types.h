@@ -3,6 +3,10 @@
 #include <cstdint>
 #include <limits>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 typedef unsigned int   uint;
 typedef unsigned short ushort;
 typedef unsigned long  ulong;
@@ -23,3 +27,36 @@ typedef double    f64;
 
 template<typename T> const T max_value() { return ( std::numeric_limits<T>::max ) ();    }
 template<typename T> const T min_value() { return ( std::numeric_limits<T>::lowest ) (); }
+
+// index of the lowest set bit, value must not be 0
+inline u32 count_trailing_zeros( u64 value )
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64( &index, value );
+    return (u32)index;
+#else
+    return (u32)__builtin_ctzll( value );
+#endif
+}
+
+// index of the highest set bit, value must not be 0
+inline u32 index_of_highest_bit( u64 value )
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64( &index, value );
+    return (u32)index;
+#else
+    return 63 - (u32)__builtin_clzll( value );
+#endif
+}
+
+inline u32 count_set_bits( u64 value )
+{
+#ifdef _MSC_VER
+    return (u32)__popcnt64( value );
+#else
+    return (u32)__builtin_popcountll( value );
+#endif
+}
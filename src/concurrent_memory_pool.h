@@ -0,0 +1,382 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+#include "basic_types.h"
+#include "basics.h"
+#include "memory_pool.h"
+
+#define DEFAULT_CONCURRENT_POOL_MAX_BLOBS 4096
+#define CONCURRENT_POOL_THREAD_HINT_COUNT 16 // pools a thread keeps a hint for at once
+
+template<typename T> class ConcurrentMemoryPool;
+
+namespace
+{
+    template<typename T>
+    struct ConcurrentMemoryBlob
+    {
+        static constexpr u32 word_count = ( get_pool_size<T>() + 63 ) / 64;
+
+        std::array<T, get_pool_size<T>()> data;
+        std::array<std::atomic<u64>, word_count> allocated;
+        std::array<std::atomic<u32>, get_pool_size<T>()> generation; // never 0, see INVALID_POOL_HANDLE
+
+        std::atomic<u32> count;
+
+        constexpr u32 size() { return get_pool_size<T>(); }
+
+        static constexpr u64 word_mask( u32 word_idx )
+        {
+            return ( word_idx == word_count - 1 && get_pool_size<T>() % 64 != 0 )
+                ? ( u64(1) << ( get_pool_size<T>() % 64 ) ) - 1
+                : ~u64(0);
+        }
+
+        bool is_allocated( u32 blob_idx ) const
+        {
+            return ( allocated[ blob_idx / 64 ].load( std::memory_order_acquire ) & ( u64(1) << ( blob_idx % 64 ) ) ) != 0;
+        }
+    };
+}
+
+// Thread safe version of MemoryPool, slots are claimed with a CAS on the allocation
+// words so any thread can instantiate or destroy elements concurrently.
+// The blob directory has a fixed capacity and is never reallocated, blobs are
+// published with a release store so readers never see a partially built blob.
+// @Note: There is no pointer to index lookup, keep the handle returned by Instantiate.
+// @Note: Accessing an element while another thread destroys it is still a race, the
+//        generation only protects against handles that were already stale.
+template<typename T>
+class ConcurrentMemoryPool : public MemoryPoolBase
+{
+private:
+    std::atomic<ConcurrentMemoryBlob<T>*>* blobs = nullptr;
+    std::atomic<u32> blob_count;
+    u32              max_blob_count;
+
+    // one bit per blob that may have a free slot: set by Destroy and Grow, cleared by the
+    // allocation that finds the blob full
+    std::atomic<u64>* free_blob_words = nullptr;
+    u32               free_blob_word_count;
+
+    u32 id; // keys the per thread hints, never reused by another pool
+
+    std::mutex grow_mutex; // only taken when every blob is full
+
+    ConcurrentMemoryBlob<T>* GetBlob( u32 blob_index )
+    {
+        if( blob_index >= blob_count.load( std::memory_order_acquire ) )
+            return nullptr;
+        return blobs[ blob_index ].load( std::memory_order_acquire );
+    }
+
+    // returns the new blob count, another thread may have grown the pool already
+    u32 Grow( u32 seen_blob_count )
+    {
+        std::lock_guard<std::mutex> lock( grow_mutex );
+
+        u32 current_count = blob_count.load( std::memory_order_acquire );
+        if( current_count != seen_blob_count )
+            return current_count;
+
+        assert_fmt( current_count < max_blob_count, "Error: ConcurrentMemoryPool is full (% blobs).", max_blob_count );
+
+        auto* new_blob = new ConcurrentMemoryBlob<T>();
+        for( auto& word : new_blob->allocated )
+            word.store( 0, std::memory_order_relaxed );
+        for( auto& generation : new_blob->generation )
+            generation.store( 1, std::memory_order_relaxed );
+        new_blob->count.store( 0, std::memory_order_relaxed );
+
+        blobs[ current_count ].store( new_blob, std::memory_order_release );
+        blob_count.store( current_count + 1, std::memory_order_release );
+        MarkFree( current_count );
+
+        return current_count + 1;
+    }
+
+    T* TryInstantiate( ConcurrentMemoryBlob<T>* blob, u32& blob_idx )
+    {
+        for( u32 word_idx = 0; word_idx < ConcurrentMemoryBlob<T>::word_count; ++word_idx )
+        {
+            auto& word = blob->allocated[ word_idx ];
+            u64 bits = word.load( std::memory_order_relaxed );
+            u64 free_bits = ~bits & ConcurrentMemoryBlob<T>::word_mask( word_idx );
+            while( free_bits != 0 )
+            {
+                u64 bit = u64(1) << count_trailing_zeros( free_bits );
+                if( word.compare_exchange_weak( bits, bits | bit, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+                {
+                    blob->count.fetch_add( 1, std::memory_order_relaxed );
+                    blob_idx = word_idx * 64 + count_trailing_zeros( bit );
+                    blob->data[ blob_idx ] = {};
+                    return &blob->data[ blob_idx ];
+                }
+                free_bits = ~bits & ConcurrentMemoryBlob<T>::word_mask( word_idx );
+            }
+        }
+        return nullptr;
+    }
+
+    static u32 NextGeneration( u32 generation )
+    {
+        return generation + 1 == 0 ? 1 : generation + 1;
+    }
+
+    void Destroy( ConcurrentMemoryBlob<T>* blob, u32 blob_idx )
+    {
+        // bump the generation before releasing the slot so it can't be reused with the old one
+        u32 generation = blob->generation[ blob_idx ].load( std::memory_order_relaxed );
+        blob->generation[ blob_idx ].store( NextGeneration( generation ), std::memory_order_relaxed );
+        Release( blob, blob_idx );
+    }
+
+    void Release( ConcurrentMemoryBlob<T>* blob, u32 blob_idx )
+    {
+        u64 bit = u64(1) << ( blob_idx % 64 );
+        u64 previous = blob->allocated[ blob_idx / 64 ].fetch_and( ~bit, std::memory_order_acq_rel );
+        assert( ( previous & bit ) != 0, "Error: Tried to destroy something not allocated." );
+        blob->count.fetch_sub( 1, std::memory_order_seq_cst ); // see MarkFree
+    }
+
+    // @Note: Destroy decrements the count then reads the bit, MarkFull clears the bit then
+    //        reads the count, both sequentially consistent so at least one of them sees the
+    //        other and a blob with a free slot is never left unmarked. Free on x86.
+    void MarkFree( u32 blob_index )
+    {
+        u64 bit = u64(1) << ( blob_index % 64 );
+        auto& word = free_blob_words[ blob_index / 64 ];
+        if( ( word.load( std::memory_order_seq_cst ) & bit ) == 0 )
+            word.fetch_or( bit, std::memory_order_seq_cst );
+    }
+
+    void MarkFull( u32 blob_index )
+    {
+        free_blob_words[ blob_index / 64 ].fetch_and( ~( u64(1) << ( blob_index % 64 ) ), std::memory_order_seq_cst );
+
+        auto* blob = blobs[ blob_index ].load( std::memory_order_acquire );
+        if( blob->count.load( std::memory_order_seq_cst ) < blob->size() )
+            MarkFree( blob_index );
+    }
+
+    T* TryInstantiate( u32 blob_index, PoolHandle& handle )
+    {
+        auto* blob = blobs[ blob_index ].load( std::memory_order_acquire );
+
+        u32 blob_idx;
+        T* inst = blob->count.load( std::memory_order_relaxed ) < blob->size() ? TryInstantiate( blob, blob_idx ) : nullptr;
+        if( inst == nullptr )
+        {
+            MarkFull( blob_index );
+            return nullptr;
+        }
+
+        handle = make_pool_handle( blob_index * blob->size() + blob_idx, blob->generation[ blob_idx ].load( std::memory_order_relaxed ) );
+        return inst;
+    }
+
+    // walks the blobs marked free starting at first_blob_index and wrapping around
+    T* TryInstantiateInFreeBlobs( u32 first_blob_index, PoolHandle& handle, u32& blob_index )
+    {
+        u32 first_word = first_blob_index / 64;
+        for( u32 i = 0; i <= free_blob_word_count; ++i )
+        {
+            u32 word_idx = ( first_word + i ) % free_blob_word_count;
+            u64 bits = free_blob_words[ word_idx ].load( std::memory_order_acquire );
+
+            // the first word is visited twice, the blobs from the start then the ones before it
+            if( i == 0 )
+                bits &= ~u64(0) << ( first_blob_index % 64 );
+            else if( i == free_blob_word_count )
+                bits &= ( u64(1) << ( first_blob_index % 64 ) ) - 1;
+
+            for( ; bits != 0; bits &= bits - 1 )
+            {
+                blob_index = word_idx * 64 + count_trailing_zeros( bits );
+                if( T* inst = TryInstantiate( blob_index, handle ) )
+                    return inst;
+            }
+        }
+        return nullptr;
+    }
+
+    static u32 NextPoolId()
+    {
+        static std::atomic<u32> next_id { 0 };
+        return next_id.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    // blob each thread last allocated in, per pool so threads spread across the blobs of
+    // every pool. A slot shared by two pools only costs the hint.
+    u32& GetThreadHint()
+    {
+        struct ThreadHint
+        {
+            u32 pool_id    = max_value<u32>();
+            u32 blob_index = 0;
+        };
+        static thread_local std::array<ThreadHint, CONCURRENT_POOL_THREAD_HINT_COUNT> hints;
+
+        ThreadHint& hint = hints[ id % CONCURRENT_POOL_THREAD_HINT_COUNT ];
+        if( hint.pool_id != id )
+            hint = { id, 0 };
+        return hint.blob_index;
+    }
+
+public:
+    ConcurrentMemoryPool( u32 max_blob_count = DEFAULT_CONCURRENT_POOL_MAX_BLOBS )
+        : max_blob_count( max_blob_count )
+    {
+        blobs = new std::atomic<ConcurrentMemoryBlob<T>*>[ max_blob_count ];
+        for( u32 i = 0; i < max_blob_count; ++i )
+            blobs[i].store( nullptr, std::memory_order_relaxed );
+        blob_count.store( 0, std::memory_order_relaxed );
+
+        free_blob_word_count = ( max_blob_count + 63 ) / 64;
+        free_blob_words = new std::atomic<u64>[ free_blob_word_count ];
+        for( u32 i = 0; i < free_blob_word_count; ++i )
+            free_blob_words[i].store( 0, std::memory_order_relaxed );
+
+        id = NextPoolId();
+        Grow( 0 );
+    }
+
+    ~ConcurrentMemoryPool()
+    {
+        u32 count = blob_count.load( std::memory_order_acquire );
+        for( u32 i = 0; i < count; ++i )
+            delete blobs[i].load( std::memory_order_relaxed );
+        delete[] blobs;
+        blobs = nullptr;
+        delete[] free_blob_words;
+        free_blob_words = nullptr;
+    }
+
+    ConcurrentMemoryPool( const ConcurrentMemoryPool& ) = delete;
+    ConcurrentMemoryPool& operator=( const ConcurrentMemoryPool& ) = delete;
+
+    T* Instantiate( PoolHandle& handle )
+    {
+        u32& thread_hint = GetThreadHint();
+
+        u32 count = blob_count.load( std::memory_order_acquire );
+        while( true )
+        {
+            u32 blob_index = thread_hint < count ? thread_hint : 0;
+            if( T* inst = TryInstantiateInFreeBlobs( blob_index, handle, blob_index ) )
+            {
+                thread_hint = blob_index;
+                return inst;
+            }
+
+            thread_hint = count;
+            count = Grow( count );
+        }
+    }
+
+    T* Instantiate()
+    {
+        PoolHandle handle;
+        return Instantiate( handle );
+    }
+
+    T* Get( u32 idx )
+    {
+        auto* blob = GetBlob( idx / get_pool_size<T>() );
+        assert( blob != nullptr, "Error: Tried to get something that doesn't belong to this pool." );
+        assert( blob->is_allocated( idx % get_pool_size<T>() ), "Error: Tried to get something not allocated." );
+        return &blob->data[ idx % get_pool_size<T>() ];
+    }
+
+    // returns nullptr if the handle is stale or doesn't belong to this pool
+    T* TryGet( PoolHandle handle )
+    {
+        u32 idx = get_pool_handle_index( handle );
+        auto* blob = GetBlob( idx / get_pool_size<T>() );
+        if( blob == nullptr )
+            return nullptr;
+
+        u32 blob_idx = idx % get_pool_size<T>();
+        if( !blob->is_allocated( blob_idx ) || blob->generation[ blob_idx ].load( std::memory_order_relaxed ) != get_pool_handle_generation( handle ) )
+            return nullptr;
+
+        return &blob->data[ blob_idx ];
+    }
+
+    bool IsValid( PoolHandle handle )
+    {
+        return TryGet( handle ) != nullptr;
+    }
+
+    void* GetRaw( u32 idx ) override
+    {
+        return static_cast<void*>( Get( idx ) );
+    }
+
+    void DestroyByIndex( u32 idx ) override
+    {
+        auto* blob = GetBlob( idx / get_pool_size<T>() );
+        assert( blob != nullptr, "Error: Tried to destroy something that doesn't belong to any blob." );
+        Destroy( blob, idx % get_pool_size<T>() );
+        MarkFree( idx / get_pool_size<T>() );
+    }
+
+    u32 InstantiateByIndex() override
+    {
+        PoolHandle handle;
+        Instantiate( handle );
+        return get_pool_handle_index( handle );
+    }
+
+    void* TryGetRaw( PoolHandle handle ) override
+    {
+        return static_cast<void*>( TryGet( handle ) );
+    }
+
+    // @Note: Checked in release too. The generation is swapped first, of two threads destroying
+    //        the same handle only one releases the slot.
+    bool DestroyByHandle( PoolHandle handle ) override
+    {
+        u32 idx = get_pool_handle_index( handle );
+        auto* blob = GetBlob( idx / get_pool_size<T>() );
+        if( blob == nullptr )
+            return false;
+
+        u32 blob_idx = idx % get_pool_size<T>();
+        u32 generation = get_pool_handle_generation( handle );
+        if( !blob->is_allocated( blob_idx ) ||
+            !blob->generation[ blob_idx ].compare_exchange_strong( generation, NextGeneration( generation ), std::memory_order_relaxed ) )
+            return false;
+
+        Release( blob, blob_idx );
+        MarkFree( idx / get_pool_size<T>() );
+        return true;
+    }
+
+    // @Note: Only the blob based stats, shared allocation counters would be a contention point.
+    MemoryPoolStats GetStats() override
+    {
+        MemoryPoolStats stats;
+        stats.element_size = sizeof(T);
+        stats.blob_count   = blob_count.load( std::memory_order_acquire );
+        stats.capacity     = stats.blob_count * get_pool_size<T>();
+        for( u32 i = 0; i < stats.blob_count; ++i )
+            stats.live_count += blobs[i].load( std::memory_order_acquire )->count.load( std::memory_order_relaxed );
+
+        u32 needed_blob_count = (std::max)( 1u, ( stats.live_count + get_pool_size<T>() - 1 ) / get_pool_size<T>() );
+        stats.fill_ratio    = stats.capacity > 0 ? (f32)stats.live_count / stats.capacity : 0.0f;
+        stats.fragmentation = stats.blob_count > 0 ? 1.0f - (f32)needed_blob_count / stats.blob_count : 0.0f;
+
+        return stats;
+    }
+
+    PoolHandle InstantiateByHandle() override
+    {
+        PoolHandle handle;
+        Instantiate( handle );
+        return handle;
+    }
+};
@@ -0,0 +1,105 @@
+#include "content_hash.h"
+
+#include <string.h>
+
+static const u64 PRIME64_1 = 11400714785074694791ull;
+static const u64 PRIME64_2 = 14029467366897019727ull;
+static const u64 PRIME64_3 =  1609587929392839161ull;
+static const u64 PRIME64_4 =  9650029242287828579ull;
+static const u64 PRIME64_5 =  2870177450012600261ull;
+
+static u64 rotate_left( u64 value, u32 count )
+{
+    return ( value << count ) | ( value >> ( 64 - count ) );
+}
+
+// @Note: memcpy loads, the data has no alignment guarantee. Assumes a little endian host.
+static u64 read_u64( const u8* ptr )
+{
+    u64 value;
+    memcpy( &value, ptr, sizeof(value) );
+    return value;
+}
+
+static u32 read_u32( const u8* ptr )
+{
+    u32 value;
+    memcpy( &value, ptr, sizeof(value) );
+    return value;
+}
+
+static u64 xxh_round( u64 accumulator, u64 input )
+{
+    accumulator += input * PRIME64_2;
+    accumulator  = rotate_left( accumulator, 31 );
+    return accumulator * PRIME64_1;
+}
+
+static u64 merge_round( u64 accumulator, u64 value )
+{
+    accumulator ^= xxh_round( 0, value );
+    return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+u64 hash_content( const void* data, u64 size, u64 seed )
+{
+    const u8* ptr = static_cast<const u8*>( data );
+    const u8* end = ptr + size;
+    u64 hash;
+
+    if( size >= 32 )
+    {
+        u64 v1 = seed + PRIME64_1 + PRIME64_2;
+        u64 v2 = seed + PRIME64_2;
+        u64 v3 = seed;
+        u64 v4 = seed - PRIME64_1;
+
+        const u8* limit = end - 32;
+        do
+        {
+            v1 = xxh_round( v1, read_u64( ptr ) );
+            v2 = xxh_round( v2, read_u64( ptr + 8 ) );
+            v3 = xxh_round( v3, read_u64( ptr + 16 ) );
+            v4 = xxh_round( v4, read_u64( ptr + 24 ) );
+            ptr += 32;
+        } while( ptr <= limit );
+
+        hash = rotate_left( v1, 1 ) + rotate_left( v2, 7 ) + rotate_left( v3, 12 ) + rotate_left( v4, 18 );
+        hash = merge_round( hash, v1 );
+        hash = merge_round( hash, v2 );
+        hash = merge_round( hash, v3 );
+        hash = merge_round( hash, v4 );
+    }
+    else
+    {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += size;
+
+    for( ; ptr + 8 <= end; ptr += 8 )
+    {
+        hash ^= xxh_round( 0, read_u64( ptr ) );
+        hash  = rotate_left( hash, 27 ) * PRIME64_1 + PRIME64_4;
+    }
+
+    if( ptr + 4 <= end )
+    {
+        hash ^= (u64)read_u32( ptr ) * PRIME64_1;
+        hash  = rotate_left( hash, 23 ) * PRIME64_2 + PRIME64_3;
+        ptr += 4;
+    }
+
+    for( ; ptr < end; ++ptr )
+    {
+        hash ^= (*ptr) * PRIME64_5;
+        hash  = rotate_left( hash, 11 ) * PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
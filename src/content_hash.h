@@ -0,0 +1,6 @@
+#pragma once
+
+#include "basic_types.h"
+
+// XXH64, fast enough to hash whole asset files on every load.
+u64 hash_content( const void* data, u64 size, u64 seed = 0 );
@@ -0,0 +1,117 @@
+#include "decode_cache.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "basics.h"
+#include "content_hash.h"
+
+static std::atomic<u32> s_hits   { 0 };
+static std::atomic<u32> s_misses { 0 };
+static std::atomic<u32> s_writes { 0 };
+static std::atomic<u32> s_temporary_count { 0 };
+
+static void make_directory( const char* path )
+{
+#ifdef _WIN32
+    _mkdir( path );
+#else
+    mkdir( path, 0755 );
+#endif
+}
+
+static void get_entry_path( u64 key, char* buffer, u32 buffer_length )
+{
+    snprintf( buffer, buffer_length, DECODE_CACHE_DIRECTORY "%016llx.bin", (unsigned long long)key );
+}
+
+u64 get_decode_cache_key( const void* source, u64 source_size, u64 settings )
+{
+    return hash_content( source, source_size, settings ^ ( (u64)DECODE_CACHE_VERSION << 56 ) );
+}
+
+bool open_decode_cache_entry( u64 key, DecodeCacheEntry& entry )
+{
+    entry = {};
+
+    char path[256];
+    get_entry_path( key, path, sizeof(path) );
+    if( map_file( path, entry.file ) && entry.file.size >= sizeof(DecodeCacheHeader) )
+    {
+        auto header = reinterpret_cast<const DecodeCacheHeader*>( entry.file.data );
+        if( header->magic == DECODE_CACHE_MAGIC && header->version == DECODE_CACHE_VERSION && header->key == key
+            && header->data_size == entry.file.size - sizeof(DecodeCacheHeader) )
+        {
+            entry.header = header;
+            entry.data   = entry.file.data + sizeof(DecodeCacheHeader);
+            s_hits.fetch_add( 1, std::memory_order_relaxed );
+            return true;
+        }
+    }
+
+    unmap_file( entry.file );
+    s_misses.fetch_add( 1, std::memory_order_relaxed );
+    return false;
+}
+
+void close_decode_cache_entry( DecodeCacheEntry& entry )
+{
+    unmap_file( entry.file );
+    entry = {};
+}
+
+bool write_decode_cache_entry( u64 key, const u32 params[4], std::initializer_list<DecodeCacheBlob> blobs )
+{
+    static std::once_flag directory_flag;
+    std::call_once( directory_flag, [] {
+        make_directory( "cache" );
+        make_directory( DECODE_CACHE_DIRECTORY );
+    } );
+
+    DecodeCacheHeader header;
+    header.key = key;
+    for( u32 i = 0; i < 4; ++i )
+        header.params[i] = params[i];
+    for( auto& blob : blobs )
+        header.data_size += blob.size;
+
+    char path[256];
+    char temporary_path[256];
+    get_entry_path( key, path, sizeof(path) );
+    snprintf( temporary_path, sizeof(temporary_path), "%s.%u.tmp", path, s_temporary_count.fetch_add( 1, std::memory_order_relaxed ) );
+
+    FILE* file = fopen( temporary_path, "wb" );
+    if( file == nullptr )
+        return false;
+
+    bool written = fwrite( &header, sizeof(header), 1, file ) == 1;
+    for( auto& blob : blobs )
+        written = written && ( blob.size == 0 || fwrite( blob.data, (size_t)blob.size, 1, file ) == 1 );
+    written = ( fclose( file ) == 0 ) && written;
+
+    // another worker may have written the same entry meanwhile, it holds the same bytes
+    if( !written || rename( temporary_path, path ) != 0 )
+    {
+        remove( temporary_path );
+        return false;
+    }
+
+    s_writes.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+}
+
+DecodeCacheStats get_decode_cache_stats()
+{
+    DecodeCacheStats stats;
+    stats.hits   = s_hits.load( std::memory_order_relaxed );
+    stats.misses = s_misses.load( std::memory_order_relaxed );
+    stats.writes = s_writes.load( std::memory_order_relaxed );
+    return stats;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <initializer_list>
+
+#include "basic_types.h"
+#include "mapped_file.h"
+
+#define DECODE_CACHE_DIRECTORY "cache/decoded/"
+#define DECODE_CACHE_MAGIC     0x43444c48 // "HLDC"
+#define DECODE_CACHE_VERSION   1          // bump when the entry layout changes
+
+// On disk cache of decoded assets, keyed by a hash of the source file content and of the
+// decode settings: an edited file or changed settings simply miss, nothing is invalidated.
+// The entry is a header followed by the ready to upload blob, a hit is one mapping.
+// @Note: Entries are never deleted, clearing the directory is always safe.
+
+struct DecodeCacheHeader
+{
+    u32 magic     = DECODE_CACHE_MAGIC;
+    u32 version   = DECODE_CACHE_VERSION;
+    u64 key       = 0;
+    u32 params[4] = {}; // decoder specific, sizes of the blob parts
+    u64 data_size = 0;
+};
+
+struct DecodeCacheEntry
+{
+    MappedFile file;
+    const DecodeCacheHeader* header = nullptr;
+    const u8* data = nullptr;
+};
+
+struct DecodeCacheBlob
+{
+    const void* data = nullptr;
+    u64 size = 0;
+};
+
+struct DecodeCacheStats
+{
+    u32 hits   = 0;
+    u32 misses = 0;
+    u32 writes = 0;
+};
+
+// settings identifies the decoder and its options, change it whenever the decoded output would change
+u64  get_decode_cache_key( const void* source, u64 source_size, u64 settings );
+
+// safe from any thread, counts a hit or a miss
+bool open_decode_cache_entry( u64 key, DecodeCacheEntry& entry );
+void close_decode_cache_entry( DecodeCacheEntry& entry );
+// the blobs are written one after the other, written to a temporary file first so readers never see half an entry
+bool write_decode_cache_entry( u64 key, const u32 params[4], std::initializer_list<DecodeCacheBlob> blobs );
+
+DecodeCacheStats get_decode_cache_stats(); // since the dll was loaded
@@ -2,6 +2,7 @@
 #include <glad/glad.h>
 #include <imgui.h>
 #include <string>
+#include <stdlib.h>
 
 #include "basics.h"
 
@@ -19,6 +20,15 @@
 
 #include "resource_pool.h"
 #include "inspector.h"
+#include "pool_stats.h"
+#include "resource_loader.h"
+#include "file_watch.h"
+#include "resource_budget.h"
+#include "asset_archive.h"
+#include "decode_cache.h"
+#include "resource_file_cache.h"
+#include "resource_dependencies.h"
+#include "load_telemetry.h"
 
 Appdata  s_default_appdata = {};
 Appdata* s_appdata = nullptr;
@@ -200,16 +210,10 @@ static void init_imgui( Appdata& appdata )
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 
     appdata.imgui_info.texture = imgui_texture;
+    appdata.imgui_info.font_atlas_param = intern_string( "FontAtlas" );
     appdata.imgui_info.shader = load_shader( get_resource_pool<Shader>(), "datas/shaders/imgui_shader.glsl" );
 }
 
-void init_resource_pools( Appdata& appdata )
-{
-    init_resource_pool<Shader>( appdata.global_store.resource_pool );
-    init_resource_pool<Texture>( appdata.global_store.resource_pool );
-    init_resource_pool<MeshDef>( appdata.global_store.resource_pool );
-}
-
 void init_immediate_mode( Appdata& appdata )
 {
     init_immediate();
@@ -226,20 +230,30 @@ void reload_dll()
 
     reload_metadata( appdata );
     report_types( appdata );
+    init_resource_pools( appdata.global_store.resource_pool, appdata.metadata );
+    init_resource_loader();
+    init_file_watch();
+    open_asset_archive( ASSET_ARCHIVE_PATH );
 
     if( !appdata.sdl_info.window )
     {
         init_graphics( appdata );
-        init_resource_pools( appdata );
 
-        appdata.test_data.checkerboard_texture = load_texture( get_resource_pool<Texture>(), "datas/textures/checkerboard.png" );
-        appdata.test_data.flower_texture = load_texture( get_resource_pool<Texture>(), "datas/textures/flowers.png" );
+        auto& resource_pool = appdata.global_store.resource_pool;
+        appdata.test_data.checkerboard_texture = get_resource<Texture>( resource_pool, load_texture_async( get_resource_pool<Texture>(), "datas/textures/checkerboard.png" ) );
+        appdata.test_data.flower_texture = get_resource<Texture>( resource_pool, load_texture_async( get_resource_pool<Texture>(), "datas/textures/flowers.png" ) );
         appdata.test_data.texture_shader = load_shader( get_resource_pool<Shader>(), "datas/shaders/transformed_texture.glsl" );
         appdata.test_data.mix_texture_shader = load_shader( get_resource_pool<Shader>(), "datas/shaders/texture_mix_shader.glsl" );
 
+        // the test data is used every frame, it must never be evicted
+        acquire_resource( appdata.test_data.checkerboard_texture );
+        acquire_resource( appdata.test_data.flower_texture );
+        acquire_resource( appdata.test_data.texture_shader );
+        acquire_resource( appdata.test_data.mix_texture_shader );
+
         appdata.test_data.entity_material = create_material( appdata.global_store.material_pool, appdata.test_data.mix_texture_shader );
-        set_material_param( appdata.test_data.entity_material, "Albedo1", appdata.test_data.checkerboard_texture->buffer );
-        set_material_param( appdata.test_data.entity_material, "Albedo2", appdata.test_data.flower_texture->buffer );
+        set_material_param( appdata.test_data.entity_material, "Albedo1", appdata.test_data.checkerboard_texture );
+        set_material_param( appdata.test_data.entity_material, "Albedo2", appdata.test_data.flower_texture );
         set_material_param( appdata.test_data.entity_material, "amount", 0.5f );
     }
     else
@@ -257,6 +271,14 @@ void unload_dll( bool last_time )
 {
     auto& appdata = get_dll_appdata();
 
+    // the workers run code from this dll
+    shutdown_file_watch();
+    shutdown_resource_loader();
+
+    // the workers are done, every load phase of the run is in the trace
+    if( const char* trace_path = getenv( LOAD_TRACE_PATH_VARIABLE ) )
+        export_load_trace( trace_path );
+
     ImGui::DestroyContext();
     cleanup_immediate();
 
@@ -264,9 +286,19 @@ void unload_dll( bool last_time )
     {
         if( appdata.sdl_info.window )
         {
-            cleanup_texture( *appdata.test_data.checkerboard_texture );
-            appdata.test_data.checkerboard_texture = nullptr;
+            auto& test_data = appdata.test_data;
+            destroy_material( appdata.global_store.material_pool, test_data.entity_material );
+            test_data.entity_material = nullptr;
+            release_resource( test_data.flower_texture );
+            release_resource( test_data.texture_shader );
+            release_resource( test_data.mix_texture_shader );
+
+            release_resource( test_data.checkerboard_texture );
+            cleanup_texture( *test_data.checkerboard_texture );
+            test_data.checkerboard_texture = nullptr;
             
+            close_asset_archive();
+
             SDL_GL_DeleteContext( appdata.sdl_info.opengl_context );
             SDL_DestroyWindow( appdata.sdl_info.window );
             appdata.sdl_info.window = nullptr;
@@ -276,6 +308,11 @@ void unload_dll( bool last_time )
     println( "[INFO]: DLL unloaded." );
 }
 
+bool pack_assets( const char* archive_path, int file_count, char** files )
+{
+    return pack_asset_archive( archive_path, std::vector<std::string>( files, files + file_count ) );
+}
+
 static void render_imgui_data( const ImDrawData* draw_data )
 {
     auto& imgui_info = get_dll_appdata().imgui_info;
@@ -315,7 +352,7 @@ static void render_imgui_data( const ImDrawData* draw_data )
 
                 // The texture for the draw call is specified by pcmd->TextureId.
                 // The vast majority of draw calls with use the imgui texture atlas, which value you have set yourself during initialization.
-                immediate_set_custom_param_value( "FontAtlas", ((Texture*)pcmd->TextureId)->buffer );
+                immediate_set_custom_param_value( imgui_info.font_atlas_param, ((Texture*)pcmd->TextureId)->buffer );
 
                 // We are using scissoring to clip some objects. All low-level graphics API supports it.
                 // If your engine doesn't support scissoring yet, you may ignore this at first. You will get some small glitches
@@ -373,6 +410,12 @@ void loop_dll( )
 
     appdata.app_state.global_timer.Tick();
     appdata.app_state.global_frame_count++;
+    update_pool_stats( appdata );
+    process_file_changes();
+    finalize_resource_loads( RESOURCE_FINALIZE_PER_FRAME );
+    process_dependency_invalidations();
+    enforce_resource_budget();
+    update_load_telemetry();
 
     appdata.input_state.frame_start();
     handle_events( appdata.input_state, appdata.app_state );
@@ -449,8 +492,25 @@ void loop_dll( )
         ImGui::Begin( "Debug", &appdata.app_state.debug_open, ImGuiWindowFlags_NoCollapse );
             ImGui::Text("Frame count: %i", appdata.app_state.global_frame_count);
             ImGui::Text("Frame rate: %f", 1.0 / appdata.app_state.global_timer.Elapsed());
+            ImGui::Text("Pending loads: %u", get_pending_resource_load_count());
+
+            auto& budget = appdata.global_store.resource_budget;
+            ImGui::Text("Resources CPU: %.1f / %.1f MB", budget.cpu_usage / ( 1024.0 * 1024.0 ), budget.cpu_budget / ( 1024.0 * 1024.0 ));
+            ImGui::Text("Resources GPU: %.1f / %.1f MB", budget.gpu_usage / ( 1024.0 * 1024.0 ), budget.gpu_budget / ( 1024.0 * 1024.0 ));
+            ImGui::Text("Evictions: %u", budget.eviction_count);
+
+            auto cache_stats = get_decode_cache_stats();
+            ImGui::Text("Decode cache: %u hits, %u misses, %u writes", cache_stats.hits, cache_stats.misses, cache_stats.writes);
+            auto parse_cache_stats = get_resource_file_cache_stats();
+            ImGui::Text("Parse cache: %u hits, %u misses, %u writes", parse_cache_stats.hits, parse_cache_stats.misses, parse_cache_stats.writes);
 
             if(ImGui::Button("Quit")) appdata.app_state.running = false;
+
+            if( ImGui::CollapsingHeader( "Pools" ) )
+                draw_pool_stats( appdata );
+
+            if( ImGui::CollapsingHeader( "Loads" ) )
+                draw_load_telemetry();
         ImGui::End();
     }
 
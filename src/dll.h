@@ -12,6 +12,8 @@ extern "C"
     DLLEXPORT void loop_dll();   // called reapetedly
     DLLEXPORT void reload_dll(); // called after reload
     DLLEXPORT void unload_dll( bool last_time ); // called before reload
+
+    DLLEXPORT bool pack_assets( const char* archive_path, int file_count, char** files ); // offline, no appdata needed
 }
 
 Appdata& get_dll_appdata();
@@ -1,70 +1,294 @@
 #include "file_parser.h"
 
 #include "basics.h"
+#include "asset_archive.h"
+#include "load_telemetry.h"
+#include "text_scanner.h"
+#include "content_hash.h"
+#include "resource_file_cache.h"
 #include <fstream>
+#include <string.h>
 
-ResourceFile parse_resource_file( const std::string& file_path )
+bool RFString::operator==( const char* text ) const
 {
-    ResourceFile file;
-    file.path = file_path;
+    return strlen( text ) == length && ( length == 0 || memcmp( ptr, text, length ) == 0 );
+}
+
+ResourceFile::ResourceFile( ResourceFile&& other )
+{
+    *this = std::move( other );
+}
 
-    std::ifstream reader( file_path );
-    if(!reader.is_open())
+ResourceFile& ResourceFile::operator=( ResourceFile&& other )
+{
+    if( this != &other )
     {
-        println("Failed to open resource file %", file_path);
-        file.is_valid = false;
-        return file;
+        unmap_file( mapping );
+
+        // the views stay valid, a mapping keeps its address and a moved vector its buffer
+        path     = std::move( other.path );
+        blocks   = std::move( other.blocks );
+        is_valid = other.is_valid;
+        mapping  = other.mapping;
+        storage  = std::move( other.storage );
+
+        other.mapping  = {};
+        other.is_valid = false;
     }
+    return *this;
+}
 
-    std::string line;
-    RFBlock current_block;
+ResourceFile::~ResourceFile()
+{
+    unmap_file( mapping );
+}
+
+// the blocks are views into [data, data+size[, nothing is copied
+static void parse_resource_view( ResourceFile& file, const char* data, u64 size )
+{
+    TextScan scan;
+    scan_block_headers( data, size, scan );
+
+    // lines before the first header or under a header without a name belong to no block
+    uint stray_lines = scan.headers.empty() ? scan.line_count : scan.headers[0].line_number - 1;
+
+    file.blocks.reserve( scan.headers.size() );
+    for( size_t i = 0; i < scan.headers.size(); ++i )
+    {
+        const ScannedBlockHeader& header = scan.headers[i];
+        bool is_last = i + 1 == scan.headers.size();
 
-    auto register_block = [] ( RFBlock& block, ResourceFile& file ) {
-        if( !block.name.empty() )
+        if( header.name_length == 0 )
         {
-            file.blocks.emplace_back( block );
-            block.name.clear();
-            block.content.clear();
+            stray_lines += ( is_last ? scan.line_count + 1 : scan.headers[i + 1].line_number ) - header.line_number;
+            continue;
         }
-    };
 
-    uint line_count = 0;
-    while( std::getline( reader, line ) )
+        const char* content_end = is_last ? data + size : scan.headers[i + 1].line;
+        u32 content_length = (u32)( content_end - header.content );
+        file.blocks.push_back( {
+            { header.name, header.name_length },
+            { header.content, content_length },
+            header.line_number,
+            hash_content( header.content, content_length ),
+            true
+        } );
+    }
+
+    if( stray_lines > 0 )
+        println( "WARNING: % line(s) found outside any block.", stray_lines );
+}
+
+// "\r\n" become "\n" like a text mode stream would do
+static void normalize_line_endings( std::vector<char>& text )
+{
+    size_t write = 0;
+    for( size_t read = 0; read < text.size(); ++read )
     {
-        ++line_count;
+        if( text[read] == '\r' && read + 1 < text.size() && text[read + 1] == '\n' )
+            continue;
+        text[write++] = text[read];
+    }
+    text.resize( write );
+}
 
-        const char* ptr = line.c_str();
-        ptr = chomp_empty_space( ptr );
-        if( *ptr == ':' )
-        {
-            register_block( current_block, file );
+ResourceFile parse_resource_file( const std::string& file_path, ResourceFileMode mode )
+{
+    ResourceFile file;
+    file.path = file_path;
 
-            const char* start = ++ptr;
-            const char* end = chomp_token( start );
+    // packed files are parsed straight from the archive mapping
+    if( auto entry = find_archive_entry( file_path.c_str(), ArchiveEntryKind::SHADER ) )
+    {
+        // nothing to read up front, the pages come in while parsing
+        u64 now = get_load_telemetry_time();
+        record_load_phase( file_path.c_str(), LoadPhase::READ, now, now, entry->data_size );
 
-            current_block.name.assign( start, end );
-            current_block.offset = line_count;
+        LoadPhaseTimer parse_timer( file_path.c_str(), LoadPhase::DECODE );
+        parse_resource_view( file, reinterpret_cast<const char*>( get_archive_data( entry ) ), entry->data_size );
+        file.is_valid = true;
+        return file;
+    }
+
+    // an unchanged source is never opened, its last parse is mapped from the cache instead
+    u64 source_size = 0, source_write_time = 0;
+    bool has_source_info = get_file_info( file_path.c_str(), source_size, source_write_time );
+    if( has_source_info )
+    {
+        u64 start = get_load_telemetry_time();
+        if( open_resource_file_cache( file_path.c_str(), mode, source_size, source_write_time, file ) )
+        {
+            record_load_phase( file_path.c_str(), LoadPhase::READ, start, get_load_telemetry_time(), file.mapping.size );
+            file.is_valid = true;
+            return file;
         }
-        else
+    }
+
+    const char* text = nullptr;
+    u64 text_size = 0;
+
+    if( mode == ResourceFileMode::MAPPED )
+    {
         {
-            if( current_block.name.empty() )
+            LoadPhaseTimer read_timer( file_path.c_str(), LoadPhase::READ );
+            if( !map_file( file_path.c_str(), file.mapping ) )
             {
-                println( "WARNING: Line found outside any block." );
+                // map_file refuses empty files, they simply have no block
+                std::ifstream probe( file_path );
+                if( !probe.is_open() )
+                    println("Failed to open resource file %", file_path);
+                file.is_valid = probe.is_open();
+                return file;
             }
-            else
+            read_timer.bytes = file.mapping.size;
+        }
+
+        text      = reinterpret_cast<const char*>( file.mapping.data );
+        text_size = file.mapping.size;
+
+        LoadPhaseTimer parse_timer( file_path.c_str(), LoadPhase::DECODE );
+        parse_resource_view( file, text, text_size );
+    }
+    else
+    {
+        {
+            LoadPhaseTimer read_timer( file_path.c_str(), LoadPhase::READ );
+            std::ifstream reader( file_path, std::ios::binary | std::ios::ate );
+            if(!reader.is_open())
             {
-                current_block.content += line;
-                current_block.content.push_back( '\n' );
+                println("Failed to open resource file %", file_path);
+                file.is_valid = false;
+                return file;
             }
+
+            file.storage.resize( (size_t)reader.tellg() );
+            reader.seekg( 0 );
+            reader.read( file.storage.data(), file.storage.size() );
+            read_timer.bytes = file.storage.size();
         }
+
+        LoadPhaseTimer parse_timer( file_path.c_str(), LoadPhase::DECODE );
+        normalize_line_endings( file.storage );
+        text      = file.storage.data();
+        text_size = file.storage.size();
+        parse_resource_view( file, text, text_size );
     }
 
-    register_block( current_block, file );
+    if( has_source_info )
+        write_resource_file_cache( file, mode, source_size, source_write_time, text, text_size );
 
     file.is_valid = true;
     return file;
 }
 
+static u64 hash_block_name( const char* name, u64 length )
+{
+    return hash_content( name, length );
+}
+
+static const RFBlockDigest* find_block_digest( const ResourceFileDigest& digest, u64 name_hash )
+{
+    for( auto& block : digest )
+    {
+        if( block.name_hash == name_hash )
+            return &block;
+    }
+    return nullptr;
+}
+
+ResourceFile reparse_resource_file( const std::string& file_path, const ResourceFileDigest& previous, ResourceFileMode mode )
+{
+    ResourceFile file = parse_resource_file( file_path, mode );
+    for( auto& block : file.blocks )
+    {
+        auto previous_block = find_block_digest( previous, hash_block_name( block.name.data(), block.name.size() ) );
+        block.changed = previous_block == nullptr || previous_block->content_hash != block.hash;
+    }
+    return file;
+}
+
+ResourceFileDigest get_resource_file_digest( const ResourceFile& file )
+{
+    ResourceFileDigest digest;
+    digest.reserve( file.blocks.size() );
+    for( auto& block : file.blocks )
+        digest.push_back( { hash_block_name( block.name.data(), block.name.size() ), block.hash } );
+    return digest;
+}
+
+const RFBlockDigest* find_block_digest( const ResourceFileDigest& digest, const char* block_name )
+{
+    return find_block_digest( digest, hash_block_name( block_name, strlen( block_name ) ) );
+}
+
+RFLexer make_lexer( const RFBlock& block )
+{
+    RFLexer lexer;
+    lexer.next_line  = block.content.begin();
+    lexer.end        = block.content.end();
+    lexer.line_start = lexer.next_line;
+    lexer.line_end   = lexer.next_line;
+    lexer.ptr        = lexer.next_line;
+    lexer.line       = block.offset; // the header, the content starts on the next line
+    return lexer;
+}
+
+bool next_lexer_line( RFLexer& lexer )
+{
+    while( lexer.next_line < lexer.end )
+    {
+        lexer.line_start = lexer.next_line;
+        lexer.line_end   = scan_new_line( lexer.line_start, lexer.end );
+        lexer.next_line  = lexer.line_end < lexer.end ? lexer.line_end + 1 : lexer.end;
+        if( lexer.line_end > lexer.line_start && lexer.line_end[-1] == '\r' )
+            --lexer.line_end;
+        ++lexer.line;
+
+        lexer.ptr = lexer.line_start;
+        while( lexer.ptr < lexer.line_end && is_empty_space( *lexer.ptr ) ) ++lexer.ptr;
+        if( lexer.ptr < lexer.line_end )
+            return true;
+    }
+    return false;
+}
+
+bool next_token( RFLexer& lexer, RFToken& token )
+{
+    const char* ptr = lexer.ptr;
+    while( ptr < lexer.line_end && is_empty_space( *ptr ) ) ++ptr;
+    if( ptr == lexer.line_end )
+    {
+        lexer.ptr = ptr;
+        return false;
+    }
+
+    const char* start = ptr;
+    if( *ptr == ':' )
+        ++ptr;
+    else while( ptr < lexer.line_end && !is_empty_space( *ptr ) && *ptr != ':' )
+        ++ptr;
+
+    token.text   = { start, (u32)( ptr - start ) };
+    token.line   = lexer.line;
+    token.column = (uint)( start - lexer.line_start ) + 1;
+    lexer.ptr    = ptr;
+    return true;
+}
+
+RFToken get_line_end_token( const RFLexer& lexer )
+{
+    return { { lexer.line_end, 0 }, lexer.line, (uint)( lexer.line_end - lexer.line_start ) + 1 };
+}
+
+// "file(line,column): message", the format the msvc output window knows how to jump to
+void report_token_error( const char* file_path, const RFToken& token, const char* message )
+{
+    if( token.text.empty() )
+        println( "ERROR: %(%,%): %.", file_path, token.line, token.column, message );
+    else
+        println( "ERROR: %(%,%): % '%'.", file_path, token.line, token.column, message, token.text.str() );
+}
+
 bool is_number(char c)
 {
     return '0' <= c && c <= '9';
@@ -4,19 +4,85 @@
 #include <string>
 
 #include "basic_types.h"
+#include "mapped_file.h"
+
+// Non owning view on the text of a ResourceFile, valid as long as the file.
+// @Note: Not null terminated, use data() with size().
+struct RFString
+{
+    const char* ptr    = nullptr;
+    u32         length = 0;
+
+    const char* data() const  { return ptr; }
+    u32         size() const  { return length; }
+    bool        empty() const { return length == 0; }
+    const char* begin() const { return ptr; }
+    const char* end() const   { return ptr + length; }
+    std::string str() const   { return std::string( ptr, length ); }
+
+    bool operator==( const char* text ) const;
+    bool operator==( const std::string& text ) const { return text.size() == length && text.compare( 0, length, ptr, length ) == 0; }
+};
 
 struct RFBlock
 {
-    std::string name;
-    std::string content;
-    uint offset;
+    RFString name;
+    RFString content; // the lines after the header up to the next one, line endings included
+    uint offset;      // line of the header, 1 based
+    u64  hash;        // hash_content of the content
+    bool changed;     // always true unless the file was reparsed, see reparse_resource_file
+};
+
+// What a parse found, kept to tell which blocks a later parse changed without keeping the file.
+struct RFBlockDigest
+{
+    u64 name_hash;
+    u64 content_hash;
+};
+typedef std::vector<RFBlockDigest> ResourceFileDigest;
+
+// A token of a block and where it is in the file, line and column are 1 based.
+struct RFToken
+{
+    RFString text;
+    uint     line;
+    uint     column;
 };
 
+// Splits a block into tokens one line at a time, a token is a run of non blank characters
+// and ':' is always a token of its own. Only views, nothing is allocated.
+struct RFLexer
+{
+    const char* next_line;
+    const char* end;
+    const char* line_start;
+    const char* line_end; // without the line ending
+    const char* ptr;
+    uint        line;
+};
+
+enum class ResourceFileMode
+{
+    MAPPED, // the file is mapped and the blocks point into it, no copy at all
+    COPY,   // the file is read in memory owned by the ResourceFile, "\r\n" become "\n"
+};
+
+// Owns what its blocks point to, the mapping or the copy, so it can only be moved.
 struct ResourceFile
 {
     std::string path;
     std::vector< RFBlock > blocks;
     bool is_valid = false;
+
+    MappedFile        mapping;
+    std::vector<char> storage;
+
+    ResourceFile() = default;
+    ResourceFile( ResourceFile&& other );
+    ResourceFile& operator=( ResourceFile&& other );
+    ResourceFile( const ResourceFile& ) = delete;
+    ResourceFile& operator=( const ResourceFile& ) = delete;
+    ~ResourceFile();
 };
 
 bool is_number     (char c);
@@ -36,4 +102,18 @@ const char* extract_file_name( const char* file, char* buffer, uint buffer_lengt
 bool try_parse_to_int ( const std::string& str, int& out );
 bool try_parse_to_uint( const std::string& str, uint& out );
 
-ResourceFile parse_resource_file( const std::string& file_path );
+// packed files are viewed in the asset archive whatever the mode
+ResourceFile parse_resource_file( const std::string& file_path, ResourceFileMode mode = ResourceFileMode::MAPPED );
+
+// a block is unchanged when the previous parse had one with the same name and content,
+// the content being hashed as read the digests of two modes don't compare
+ResourceFile reparse_resource_file( const std::string& file_path, const ResourceFileDigest& previous, ResourceFileMode mode = ResourceFileMode::MAPPED );
+
+RFLexer make_lexer( const RFBlock& block );
+bool next_lexer_line( RFLexer& lexer );                   // skips the blank lines, false once the block is done
+bool next_token     ( RFLexer& lexer, RFToken& token );   // false at the end of the line
+RFToken get_line_end_token( const RFLexer& lexer );       // empty, where a missing token would have been
+void report_token_error( const char* file_path, const RFToken& token, const char* message );
+
+ResourceFileDigest   get_resource_file_digest( const ResourceFile& file );
+const RFBlockDigest* find_block_digest( const ResourceFileDigest& digest, const char* block_name ); // nullptr if the parse had no such block
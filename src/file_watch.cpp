@@ -0,0 +1,218 @@
+#include "file_watch.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "basics.h"
+#include "dll.h"
+#include "resource_pool.h"
+#include "mapped_file.h"
+
+#define FILE_WATCH_POLL_MS 100
+
+namespace
+{
+    // the fine grained write time, a save within the same second as the previous one still
+    // changes it, and the size for the file systems that only keep seconds
+    struct FileStamp
+    {
+        u64 size       = 0;
+        u64 write_time = 0;
+
+        bool operator!=( const FileStamp& other ) const { return size != other.size || write_time != other.write_time; }
+    };
+
+    struct FileWatch
+    {
+        std::thread       thread;
+        std::atomic<bool> running { false };
+
+        std::mutex            mutex;
+        std::set<std::string> changed_paths; // filled by the thread, drained each frame
+
+#ifdef __linux__
+        int inotify_fd = -1;
+        std::unordered_map<int, std::string>         directories; // watch descriptor to directory
+        std::unordered_map<std::string, std::string> watched_files; // path to its directory
+#else
+        std::unordered_map<std::string, FileStamp>   watched_files; // path to its last stamp
+#endif
+    };
+}
+
+// the thread runs dll code, so the watch lives in the dll and is rebuilt on each reload
+static FileWatch s_file_watch;
+
+static bool get_file_stamp( const char* path, FileStamp& stamp )
+{
+    return get_file_info( path, stamp.size, stamp.write_time );
+}
+
+
+#ifdef __linux__
+static void watch_thread()
+{
+    std::vector<char> buffer( 64 * 1024 );
+    while( s_file_watch.running )
+    {
+        pollfd poll_fd = { s_file_watch.inotify_fd, POLLIN, 0 };
+        if( poll( &poll_fd, 1, FILE_WATCH_POLL_MS ) <= 0 )
+            continue;
+
+        ssize_t length = read( s_file_watch.inotify_fd, buffer.data(), buffer.size() );
+        if( length <= 0 )
+            continue;
+
+        std::lock_guard<std::mutex> lock( s_file_watch.mutex );
+        for( ssize_t offset = 0; offset < length; )
+        {
+            auto event = reinterpret_cast<const inotify_event*>( buffer.data() + offset );
+            offset += sizeof( inotify_event ) + event->len;
+
+            auto directory = s_file_watch.directories.find( event->wd );
+            if( event->len == 0 || directory == s_file_watch.directories.end() )
+                continue;
+
+            std::string path = directory->second.empty() ? event->name : directory->second + "/" + event->name;
+            if( s_file_watch.watched_files.count( path ) )
+                s_file_watch.changed_paths.insert( path );
+        }
+    }
+}
+
+static void add_watch( const std::string& path )
+{
+    size_t separator = path.find_last_of( "/\\" );
+    std::string directory = separator == std::string::npos ? "" : path.substr( 0, separator );
+
+    // editors often save through a rename, so moves into the directory count as writes
+    int wd = inotify_add_watch( s_file_watch.inotify_fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO );
+    if( wd < 0 )
+    {
+        println( "WARNING: Can't watch %.", path.c_str() );
+        return;
+    }
+
+    s_file_watch.directories[wd] = directory;
+    s_file_watch.watched_files[path] = directory;
+}
+#else
+static void watch_thread()
+{
+    while( s_file_watch.running )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( FILE_WATCH_POLL_MS ) );
+
+        std::lock_guard<std::mutex> lock( s_file_watch.mutex );
+        for( auto& file : s_file_watch.watched_files )
+        {
+            FileStamp stamp;
+            if( get_file_stamp( file.first.c_str(), stamp ) && stamp != file.second )
+            {
+                file.second = stamp;
+                s_file_watch.changed_paths.insert( file.first );
+            }
+        }
+    }
+}
+
+static void add_watch( const std::string& path )
+{
+    FileStamp stamp;
+    get_file_stamp( path.c_str(), stamp );
+    s_file_watch.watched_files[path] = stamp;
+}
+#endif
+
+void init_file_watch()
+{
+    assert( !s_file_watch.running, "File watch is already running." );
+
+#ifdef __linux__
+    s_file_watch.inotify_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( s_file_watch.inotify_fd < 0 )
+    {
+        println( "WARNING: inotify is not available, resources won't reload when their files change." );
+        return;
+    }
+#endif
+
+    s_file_watch.running = true;
+    s_file_watch.thread = std::thread( watch_thread );
+
+    for( auto source : get_dll_appdata().global_store.resource_sources_pool )
+        watch_file( resolve_string( source->source ) );
+}
+
+void shutdown_file_watch()
+{
+    if( !s_file_watch.running )
+        return;
+
+    s_file_watch.running = false;
+    s_file_watch.thread.join();
+
+#ifdef __linux__
+    close( s_file_watch.inotify_fd );
+    s_file_watch.inotify_fd = -1;
+    s_file_watch.directories.clear();
+#endif
+    s_file_watch.watched_files.clear();
+    s_file_watch.changed_paths.clear();
+}
+
+void watch_file( const char* path )
+{
+    if( !s_file_watch.running )
+        return;
+
+    // some sources aren't files (e.g. "imgui")
+    FileStamp stamp;
+    if( !get_file_stamp( path, stamp ) )
+        return;
+
+    // paths are compared as the sources wrote them
+    std::lock_guard<std::mutex> lock( s_file_watch.mutex );
+    if( !s_file_watch.watched_files.count( path ) )
+        add_watch( path );
+}
+
+void process_file_changes()
+{
+    std::set<std::string> changed_paths;
+    {
+        std::lock_guard<std::mutex> lock( s_file_watch.mutex );
+        if( s_file_watch.changed_paths.empty() )
+            return;
+        changed_paths.swap( s_file_watch.changed_paths );
+    }
+
+    auto& sources_pool = get_dll_appdata().global_store.resource_sources_pool;
+    for( const auto& path : changed_paths )
+    {
+        ResourceSource* source = find_source( sources_pool, path.c_str() );
+        if( source == nullptr )
+            continue;
+
+        // reloading can move the resource to another source, iterate on a copy
+        std::vector<Resource*> resources = source->resources;
+        for( Resource* resource : resources )
+        {
+            println( "[INFO]: % changed, reloading %.", path.c_str(), resolve_string( resource->name ) );
+            if( !reload_resource( resource ) )
+                println( "WARNING: No reloader for the type of %.", resolve_string( resource->name ) );
+        }
+    }
+}
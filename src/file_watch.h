@@ -0,0 +1,13 @@
+#pragma once
+
+// Watches the source files of the resources on a background thread and reloads the
+// resources of a changed source at the next frame boundary.
+// @Platform: inotify on Linux, elsewhere the thread polls the modification times.
+
+void init_file_watch();     // starts the thread and watches the sources already known
+void shutdown_file_watch(); // call before the dll is unloaded
+
+void watch_file( const char* path );
+
+// main thread, once per frame: reloads the resources of the sources changed since the last call
+void process_file_changes();
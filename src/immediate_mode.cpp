@@ -2,6 +2,7 @@
 
 #include "basics.h"
 #include "resource_pool.h"
+#include "resource_budget.h"
 
 #include <SDL.h>
 #include <glad/glad.h>
@@ -120,8 +121,10 @@ void immediate_set_projection_matrix( const Matrix4& p )
     immediate_context.projection_matrix = p;
 }
 
-void immediate_set_texture( const Texture* texture )
+void immediate_set_texture( Texture* texture )
 {
+    if( texture )
+        use_resource( texture );
     immediate_context.texture = texture;
 }
 
@@ -520,6 +523,16 @@ void immediate_set_shader( const Shader& shader )
 
 void immediate_set_material(const Material* material)
 {
+    // textures of the material are used through their GL names, mark them for the budget
+    if( material )
+    {
+        for( auto& param : material->param_instances )
+        {
+            if( param.texture )
+                use_resource( param.texture );
+        }
+    }
+
 	const auto prev_material = immediate_context.material;
 	immediate_context.material = material;
 	if (prev_material != immediate_context.material)
@@ -527,6 +540,11 @@ void immediate_set_material(const Material* material)
 }
 
 void immediate_set_custom_param_value( const char* param_name, Variant value )
+{
+    immediate_set_custom_param_value( find_string( param_name ), value );
+}
+
+void immediate_set_custom_param_value( StringId param_name, Variant value )
 {
     if( !immediate_context.shader )
         return;
@@ -707,8 +725,10 @@ void immediate_draw_quad(
     indices[index_count++] = idx4;
 }
 
-void immediate_draw_mesh( const MeshDef* mesh )
+void immediate_draw_mesh( MeshDef* mesh )
 {
+    use_resource( mesh );
+
     auto& ic_vertex_count = immediate_context.vertex_count;
     auto& ic_index_count  = immediate_context.index_count;
     auto& ic_vertices     = immediate_context.vertices;
@@ -19,11 +19,12 @@ void immediate_set_shader       ( const Shader& shader );
 void immediate_set_world_matrix ( const Matrix4& w );
 void immediate_set_view_matrix  ( const Matrix4& v );
 void immediate_set_projection_matrix( const Matrix4& p );
-void immediate_set_texture( const Texture* texture );
+void immediate_set_texture( Texture* texture ); // marks the texture as used, see use_resource
 void immediate_set_draw_type    ( uint type );
 void immediate_set_depth        ( float depth );
 void immediate_set_material     ( const Material* material );
 
+void immediate_set_custom_param_value( StringId param_name, Variant value );
 void immediate_set_custom_param_value( const char* param_name, Variant value );
 
 void immediate_enable_depth_test( bool enabled );
@@ -53,4 +54,4 @@ void immediate_draw_quad(  const Vector3& p1, const Color& c1,
                             const Vector3& p3, const Color& c3,
                             const Vector3& p4, const Color& c4 );
 
-void immediate_draw_mesh( const MeshDef* mesh );
\ No newline at end of file
+void immediate_draw_mesh( MeshDef* mesh ); // an evicted mesh draws nothing until it is reloaded
\ No newline at end of file
@@ -251,10 +251,10 @@ bool draw_data_inspector_override( const char* name, const TypeInfo* type, u8* d
             if(ImGui::TreeNode( name ) )
             {
                 auto material = ((Material*)data);
-                ImGui::LabelText( "Shader name: %s", material->shader->name.c_str() );
+                ImGui::LabelText( "Shader name: %s", resolve_string( material->shader->name ) );
                 for( int i=0; i<material->param_instances.size(); ++i )
                 {
-                    draw_variant_inspector( material->param_instances[i].name, material->param_instances[i].value );
+                    draw_variant_inspector( resolve_string( material->param_instances[i].name ), material->param_instances[i].value );
                 }
                 ImGui::TreePop();
             }
@@ -0,0 +1,220 @@
+#include "load_telemetry.h"
+
+#include <imgui.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "basics.h"
+#include "dll.h"
+
+namespace
+{
+    struct LoadEvent
+    {
+        std::string path;
+        LoadPhase   phase;
+        u64         start;
+        u64         end;
+        u64         bytes;
+        u32         thread;
+    };
+
+    struct LoadTrace
+    {
+        std::mutex             mutex;
+        std::vector<LoadEvent> events;
+        std::vector<LoadEvent> pending_events; // not given to their source yet, never capped
+        u32                    dropped_count = 0;
+    };
+}
+
+// the events are only kept for the trace export, a dll reload starts a new trace
+static LoadTrace s_load_trace;
+static std::atomic<u32> s_thread_count { 0 };
+
+static u32 get_thread_index()
+{
+    static thread_local u32 thread_index = s_thread_count.fetch_add( 1, std::memory_order_relaxed );
+    return thread_index;
+}
+
+const char* to_string( LoadPhase phase )
+{
+    switch( phase )
+    {
+        case LoadPhase::READ:   return "Read";
+        case LoadPhase::DECODE: return "Decode";
+        case LoadPhase::UPLOAD: return "Upload";
+        default:                return "Unknown";
+    }
+}
+
+u64 get_load_telemetry_time()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+LoadPhaseTimer::LoadPhaseTimer( const char* path, LoadPhase phase )
+    : path( path ), phase( phase ), start( get_load_telemetry_time() )
+{
+}
+
+LoadPhaseTimer::~LoadPhaseTimer()
+{
+    record_load_phase( path, phase, start, get_load_telemetry_time(), bytes );
+}
+
+void record_load_phase( const char* path, LoadPhase phase, u64 start_us, u64 end_us, u64 bytes )
+{
+    LoadEvent event = { path, phase, start_us, end_us, bytes, get_thread_index() };
+
+    std::lock_guard<std::mutex> lock( s_load_trace.mutex );
+    if( s_load_trace.events.size() < LOAD_TRACE_MAX_EVENTS )
+        s_load_trace.events.push_back( event );
+    else
+        s_load_trace.dropped_count++;
+    s_load_trace.pending_events.push_back( std::move( event ) );
+}
+
+static std::vector<LoadEvent> s_attached_events;
+void update_load_telemetry()
+{
+    // swapped out so the loader threads aren't blocked by the source lookups
+    s_attached_events.clear();
+    {
+        std::lock_guard<std::mutex> lock( s_load_trace.mutex );
+        s_attached_events.swap( s_load_trace.pending_events );
+    }
+
+    for( const LoadEvent& event : s_attached_events )
+    {
+        // @Note: Phases recorded before their source exists (a mesh before its finalize) are only in the trace.
+        auto source = get_source( event.path.c_str(), false );
+        if( source == nullptr )
+            continue;
+
+        auto& telemetry = source->telemetry;
+        if( event.phase == LoadPhase::READ )
+        {
+            // a read starts a new load, the other phases add up until the next one
+            for( u32 i = 0; i < (u32)LoadPhase::Count; ++i )
+            {
+                telemetry.phase_time[i]  = 0;
+                telemetry.phase_bytes[i] = 0;
+            }
+            telemetry.load_count++;
+        }
+
+        f64 duration = ( event.end - event.start ) / 1000000.0;
+        telemetry.phase_time [ (u32)event.phase ] += duration;
+        telemetry.phase_bytes[ (u32)event.phase ] += event.bytes;
+        telemetry.total_time += duration;
+    }
+}
+
+static std::vector<const ResourceSource*> s_sorted_sources;
+void draw_load_telemetry()
+{
+    s_sorted_sources.clear();
+    for( auto source : get_dll_appdata().global_store.resource_sources_pool )
+    {
+        if( source->telemetry.load_count > 0 )
+            s_sorted_sources.push_back( source );
+    }
+
+    // slowest first
+    std::sort( s_sorted_sources.begin(), s_sorted_sources.end(), []( const ResourceSource* a, const ResourceSource* b ) {
+        return a->telemetry.total_time > b->telemetry.total_time;
+    } );
+
+    ImGui::Columns( 7, "LoadTelemetry" );
+    ImGui::Text( "Source" );     ImGui::NextColumn();
+    ImGui::Text( "Loads" );      ImGui::NextColumn();
+    ImGui::Text( "Read ms" );    ImGui::NextColumn();
+    ImGui::Text( "Read KB" );    ImGui::NextColumn();
+    ImGui::Text( "Decode ms" );  ImGui::NextColumn();
+    ImGui::Text( "Upload ms" );  ImGui::NextColumn();
+    ImGui::Text( "Total ms" );   ImGui::NextColumn();
+    ImGui::Separator();
+
+    for( auto source : s_sorted_sources )
+    {
+        const auto& telemetry = source->telemetry;
+        ImGui::Text( "%s", resolve_string( source->source ) );                                        ImGui::NextColumn();
+        ImGui::Text( "%u", telemetry.load_count );                                                   ImGui::NextColumn();
+        ImGui::Text( "%.2f", telemetry.phase_time[ (u32)LoadPhase::READ ] * 1000.0 );                ImGui::NextColumn();
+        ImGui::Text( "%.1f", telemetry.phase_bytes[ (u32)LoadPhase::READ ] / 1024.0 );               ImGui::NextColumn();
+        ImGui::Text( "%.2f", telemetry.phase_time[ (u32)LoadPhase::DECODE ] * 1000.0 );              ImGui::NextColumn();
+        ImGui::Text( "%.2f", telemetry.phase_time[ (u32)LoadPhase::UPLOAD ] * 1000.0 );              ImGui::NextColumn();
+        ImGui::Text( "%.2f", telemetry.total_time * 1000.0 );                                        ImGui::NextColumn();
+    }
+    ImGui::Columns( 1 );
+
+    u32 dropped_count;
+    {
+        std::lock_guard<std::mutex> lock( s_load_trace.mutex );
+        dropped_count = s_load_trace.dropped_count;
+    }
+    if( dropped_count > 0 )
+        ImGui::TextDisabled( "%u phases weren't traced, the trace is full.", dropped_count );
+
+    if( ImGui::Button( "Export load trace" ) )
+        export_load_trace( "load_trace.json" );
+}
+
+static void write_json_string( std::ofstream& writer, const std::string& text )
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    writer << '"';
+    for( char c : text )
+    {
+        switch( c )
+        {
+            case '"':  writer << "\\\""; break;
+            case '\\': writer << "\\\\"; break;
+            case '\n': writer << "\\n"; break;
+            case '\r': writer << "\\r"; break;
+            case '\t': writer << "\\t"; break;
+            default:
+                if( (u8)c < 0x20 )
+                    writer << "\\u00" << hex_digits[ c >> 4 ] << hex_digits[ c & 0xF ];
+                else
+                    writer << c;
+        }
+    }
+    writer << '"';
+}
+
+bool export_load_trace( const char* path )
+{
+    std::ofstream writer( path );
+    if( !writer.is_open() )
+    {
+        println( "Failed to open load trace file %", path );
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock( s_load_trace.mutex );
+    writer << "{\"traceEvents\":[\n";
+    for( size_t i = 0; i < s_load_trace.events.size(); ++i )
+    {
+        const LoadEvent& event = s_load_trace.events[i];
+        writer << "{\"name\":";
+        write_json_string( writer, event.path );
+        writer << ",\"cat\":\"" << to_string( event.phase ) << "\""
+               << ",\"ph\":\"X\",\"pid\":1"
+               << ",\"tid\":" << event.thread
+               << ",\"ts\":" << event.start
+               << ",\"dur\":" << ( event.end - event.start )
+               << ",\"args\":{\"bytes\":" << event.bytes << "}}"
+               << ( i + 1 < s_load_trace.events.size() ? ",\n" : "\n" );
+    }
+    writer << "]}\n";
+
+    return true;
+}
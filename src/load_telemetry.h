@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include "basic_types.h"
+
+#define LOAD_TRACE_MAX_EVENTS 65536 // the trace stops recording past this, the per source telemetry keeps updating
+
+enum class LoadPhase : u32
+{
+    READ,   // file io, bytes are the bytes read
+    DECODE, // parsing, image and mesh decoding, shader compilation
+    UPLOAD, // GL uploads, bytes are the bytes sent
+
+    Count,
+};
+const char* to_string( LoadPhase phase );
+
+// Last load of a source, filled on the main thread by update_load_telemetry.
+struct LoadTelemetry
+{
+    f64 phase_time [ (u32)LoadPhase::Count ] = {}; // seconds
+    u64 phase_bytes[ (u32)LoadPhase::Count ] = {};
+    u32 load_count = 0;
+    f64 total_time = 0; // every load of the source
+};
+
+// Times a load phase from its construction to its destruction, from any thread.
+struct LoadPhaseTimer
+{
+    LoadPhaseTimer( const char* path, LoadPhase phase );
+    ~LoadPhaseTimer();
+
+    const char* path;
+    LoadPhase   phase;
+    u64         start;
+    u64         bytes = 0;
+};
+
+void record_load_phase( const char* path, LoadPhase phase, u64 start_us, u64 end_us, u64 bytes );
+u64  get_load_telemetry_time(); // microseconds
+
+// main thread, once per frame: attaches the phases recorded since the last call to their sources
+void update_load_telemetry();
+
+// ImGui content of the load panel, to call inside a window
+void draw_load_telemetry();
+
+// every recorded phase as a chrome://tracing / Perfetto json file
+bool export_load_trace( const char* path );
+
+// when set, names the file the trace is exported to at every dll unload, for runs without the UI
+#define LOAD_TRACE_PATH_VARIABLE "HOTLOADING_LOAD_TRACE"
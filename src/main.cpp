@@ -1,4 +1,5 @@
 #include <string>
+#include <string.h>
 
 #include <windows.h>
 
@@ -90,8 +91,26 @@ void reload_dll( Appdata& appdata )
     reinterpret_cast< void(*)() >( appdata.dll_info.reload_func )();
 }
 
-int main(int, char**)
+// the packer lives in the dll with the decoders, it runs without any window or appdata
+bool pack_assets( const char* archive_path, int file_count, char** files )
 {
+    HMODULE instance = LoadLibraryW( L"HotLoadingDLL.dll" );
+    assert_fmt( instance, "Failed to load HotLoadingDLL. ( error code: % )", GetLastError() );
+
+    auto pack_func = GetProcAddress( instance, "pack_assets" );
+    assert( pack_func, "Failed to load pack_assets function." );
+
+    bool packed = reinterpret_cast< bool(*)( const char*, int, char** ) >( pack_func )( archive_path, file_count, files );
+    FreeLibrary( instance );
+    return packed;
+}
+
+int main(int argc, char** argv)
+{
+    // HotLoading --pack <archive> <files...>
+    if( argc > 2 && strcmp( argv[1], "--pack" ) == 0 )
+        return pack_assets( argv[2], argc - 3, argv + 3 ) ? 0 : 1;
+
     Appdata appdata;
 
     appdata.app_state.running = true;
@@ -0,0 +1,109 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool map_file( const char* path, MappedFile& out_file )
+{
+    out_file = {};
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER size;
+    if( !GetFileSizeEx( file, &size ) || size.QuadPart == 0 )
+    {
+        CloseHandle( file );
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( mapping == nullptr )
+    {
+        CloseHandle( file );
+        return false;
+    }
+
+    void* data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if( data == nullptr )
+    {
+        CloseHandle( mapping );
+        CloseHandle( file );
+        return false;
+    }
+
+    out_file.data           = static_cast<const u8*>( data );
+    out_file.size           = (u64)size.QuadPart;
+    out_file.file_handle    = file;
+    out_file.mapping_handle = mapping;
+#else
+    int fd = open( path, O_RDONLY );
+    if( fd < 0 )
+        return false;
+
+    struct stat info;
+    if( fstat( fd, &info ) != 0 || info.st_size == 0 )
+    {
+        close( fd );
+        return false;
+    }
+
+    // the mapping keeps the file alive, the descriptor isn't needed anymore
+    void* data = mmap( nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( data == MAP_FAILED )
+        return false;
+
+    out_file.data = static_cast<const u8*>( data );
+    out_file.size = (u64)info.st_size;
+#endif
+
+    return true;
+}
+
+void unmap_file( MappedFile& file )
+{
+    if( file.data == nullptr )
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile( file.data );
+    CloseHandle( (HANDLE)file.mapping_handle );
+    CloseHandle( (HANDLE)file.file_handle );
+#else
+    munmap( const_cast<u8*>( file.data ), (size_t)file.size );
+#endif
+
+    file = {};
+}
+
+bool get_file_info( const char* path, u64& size, u64& write_time )
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if( !GetFileAttributesExA( path, GetFileExInfoStandard, &info ) )
+        return false;
+    size       = ( (u64)info.nFileSizeHigh << 32 ) | info.nFileSizeLow;
+    write_time = ( (u64)info.ftLastWriteTime.dwHighDateTime << 32 ) | info.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat info;
+    if( stat( path, &info ) != 0 )
+        return false;
+    size = (u64)info.st_size;
+    // @Platform: seconds are too coarse, a file saved twice in a second would look unchanged
+#ifdef __APPLE__
+    write_time = (u64)info.st_mtimespec.tv_sec * 1000000000ull + (u64)info.st_mtimespec.tv_nsec;
+#else
+    write_time = (u64)info.st_mtim.tv_sec * 1000000000ull + (u64)info.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "basic_types.h"
+
+// Read only view of a whole file, the pages are loaded by the system on first access.
+struct MappedFile
+{
+    const u8* data = nullptr;
+    u64       size = 0;
+
+    void* file_handle    = nullptr; // @Platform: HANDLEs on Windows, unused elsewhere
+    void* mapping_handle = nullptr;
+};
+
+bool map_file( const char* path, MappedFile& out_file ); // false if the file can't be opened or is empty
+void unmap_file( MappedFile& file );
+
+// write_time is in the finest unit the platform has, only compare it with another write_time
+bool get_file_info( const char* path, u64& size, u64& write_time );
@@ -1,21 +1,98 @@
 #pragma once
 
+#include <new>
 #include <array>
+#include <vector>
 #include <iterator>
 #include <algorithm>
 
 #include "basic_types.h"
 #include "basics.h"
+#include "virtual_memory.h"
 
 #define DEFAULT_POOL_SIZE 32
+#define INVALID_POOL_HANDLE 0
+
+// Allocation counters (peak, totals and rates), set to 0 to compile them out.
+// Live count, blob count, fill ratio and fragmentation come from the blobs and are always there.
+#ifndef MEMORY_POOL_STATS
+#define MEMORY_POOL_STATS 1
+#endif
+
+#if MEMORY_POOL_STATS
+#define POOL_STATS( ... ) __VA_ARGS__
+#else
+#define POOL_STATS( ... )
+#endif
+
+#define POOL_COMMIT_SIZE            ( 64 * 1024 )
+#define POOL_HUGE_PAGE_COMMIT_SIZE  ( 2 * 1024 * 1024 )
 
 class MemoryPoolBase;
 template<typename T> class MemoryPoolIterator;
 template<typename T> class MemoryPool;
 
+template<typename T, typename F> void for_each_chunk( MemoryPool<T>& pool, F callback );
+
 template<typename T>
 constexpr u32 get_pool_size() { return DEFAULT_POOL_SIZE; }
 
+// Number of elements a blob can hold while staying within page_count memory pages,
+// use it to specialize get_pool_size for a type right after its declaration.
+// Per element: the data, a u32 generation and one allocation bit. The constant
+// covers the blob header and the rounding of the allocation words.
+template<typename T>
+constexpr u32 get_page_fitting_pool_size( u32 page_count = 1 )
+{
+    return (u32)( ( (u64)page_count * MEMORY_PAGE_SIZE - 48 ) * 8 / ( ( sizeof(T) + sizeof(u32) ) * 8 + 1 ) );
+}
+
+struct MemoryPoolConfig
+{
+    u64  reserve_size = 0;      // address space reserved for the blobs, 0 allocates them on the heap
+    bool huge_pages   = false;  // commit by huge page sized chunks and ask for transparent huge pages
+};
+
+// Handle to a pool element: the index of the element in the low 32 bits and the
+// generation of its slot in the high 32 bits. A slot generation changes each time
+// its element is destroyed, so stale handles never alias a newer element.
+typedef u64 PoolHandle;
+
+inline PoolHandle make_pool_handle( u32 index, u32 generation ) { return ( (u64)generation << 32 ) | index; }
+inline u32 get_pool_handle_index( PoolHandle handle )      { return (u32)( handle & 0xFFFFFFFF ); }
+inline u32 get_pool_handle_generation( PoolHandle handle ) { return (u32)( handle >> 32 ); }
+
+// Element moved by MemoryPool::Compact, the old handle is stale after the move.
+struct MemoryPoolRelocation
+{
+    PoolHandle old_handle;
+    PoolHandle new_handle;
+};
+
+// Relocations returned by Compact are sorted by old index, returns the handle unchanged
+// if it wasn't moved.
+inline PoolHandle remap_pool_handle( const std::vector<MemoryPoolRelocation>& relocations, PoolHandle handle )
+{
+    auto it = std::lower_bound( relocations.begin(), relocations.end(), handle,
+        []( const MemoryPoolRelocation& r, PoolHandle h ) { return get_pool_handle_index( r.old_handle ) < get_pool_handle_index( h ); } );
+    if( it != relocations.end() && it->old_handle == handle )
+        return it->new_handle;
+    return handle;
+}
+
+// Run of contiguous elements claimed by MemoryPool::InstantiateN, never spans two blobs.
+template<typename T>
+struct MemoryPoolSpan
+{
+    T*  data        = nullptr;
+    u32 first_index = 0; // pool index of data[0], the span covers [first_index, first_index + count[
+    u32 count       = 0;
+
+    T* begin() const { return data; }
+    T* end()   const { return data + count; }
+    T& operator[]( u32 idx ) const { return data[idx]; }
+};
+
 namespace
 {
     template<typename T>
@@ -23,24 +100,124 @@ namespace
     {
         friend class MemoryPoolIterator<T>;
 
-        std::array<T, get_pool_size<T>()> data;
-        std::array<u8, get_pool_size<T>() / 8> allocated;
+        static constexpr u32 word_count = ( get_pool_size<T>() + 63 ) / 64;
 
-        u32 high;
-        u32 low;
+        std::array<T, get_pool_size<T>()> data;
+        std::array<u64, word_count> allocated;
+        std::array<u32, get_pool_size<T>()> generation; // never 0, see INVALID_POOL_HANDLE
 
-        MemoryBlob<T>* next;
+        u32 count;     // number of live elements
+        u32 free_word; // no free slot before this word
+        u32 index;     // position of the blob in the pool directory
+        bool in_free_list;
 
         constexpr u32 size() { return get_pool_size<T>(); }
+
+        // bits of the word that map to actual slots
+        static constexpr u64 word_mask( u32 word_idx )
+        {
+            return ( word_idx == word_count - 1 && get_pool_size<T>() % 64 != 0 )
+                ? ( u64(1) << ( get_pool_size<T>() % 64 ) ) - 1
+                : ~u64(0);
+        }
+
+        bool is_allocated( u32 blob_idx ) const
+        {
+            return ( allocated[ blob_idx / 64 ] & ( u64(1) << ( blob_idx % 64 ) ) ) != 0;
+        }
+
+        bool is_full() const { return count == get_pool_size<T>(); }
+    };
+
+    // address range covered by the data of a blob, kept sorted by begin in the pool
+    struct MemoryBlobRange
+    {
+        uintptr_t begin;
+        uintptr_t end;
+        u32       blob_index;
     };
 }
 
+struct MemoryPoolStats
+{
+    u32 element_size     = 0;
+    u32 live_count       = 0;
+    u32 peak_count       = 0;
+    u32 blob_count       = 0;
+    u32 capacity         = 0; // slots in all the blobs
+    f32 fill_ratio       = 0; // live_count / capacity
+    f32 fragmentation    = 0; // share of the blobs Compact would release
+    u64 allocation_count = 0; // since the pool creation
+    u64 free_count       = 0;
+    f32 allocation_rate  = 0; // per second, over the last SampleRates period
+    f32 free_rate        = 0;
+};
+
 class MemoryPoolBase
 {
 public:
+    virtual MemoryPoolStats GetStats() = 0;
+
+    // updates the allocation and free rates from the counts since the previous call
+    void SampleRates( f64 elapsed_seconds )
+    {
+#if MEMORY_POOL_STATS
+        if( elapsed_seconds <= 0 )
+            return;
+        counters.allocation_rate = (f32)( ( counters.allocation_count - counters.sampled_allocation_count ) / elapsed_seconds );
+        counters.free_rate       = (f32)( ( counters.free_count - counters.sampled_free_count ) / elapsed_seconds );
+        counters.sampled_allocation_count = counters.allocation_count;
+        counters.sampled_free_count       = counters.free_count;
+#endif
+    }
+
     virtual void* GetRaw( u32 idx ) = 0;
     virtual void DestroyByIndex( u32 idx ) = 0;
     virtual u32 InstantiateByIndex() = 0;
+
+    virtual void* TryGetRaw( PoolHandle handle ) = 0;
+    virtual bool DestroyByHandle( PoolHandle handle ) = 0; // false and nothing destroyed if the handle is stale
+    virtual PoolHandle InstantiateByHandle() = 0;
+
+protected:
+#if MEMORY_POOL_STATS
+    struct Counters
+    {
+        u32 live_count       = 0;
+        u32 peak_count       = 0;
+        u64 allocation_count = 0;
+        u64 free_count       = 0;
+
+        u64 sampled_allocation_count = 0;
+        u64 sampled_free_count       = 0;
+        f32 allocation_rate = 0;
+        f32 free_rate       = 0;
+    };
+    Counters counters;
+
+    void CountAllocation( u32 count = 1 )
+    {
+        counters.allocation_count += count;
+        counters.live_count += count;
+        if( counters.live_count > counters.peak_count )
+            counters.peak_count = counters.live_count;
+    }
+
+    void CountFree( u32 count = 1 )
+    {
+        counters.free_count += count;
+        counters.live_count -= count;
+    }
+
+    void FillCounterStats( MemoryPoolStats& stats ) const
+    {
+        stats.peak_count       = counters.peak_count;
+        stats.allocation_count = counters.allocation_count;
+        stats.free_count       = counters.free_count;
+        stats.allocation_rate  = counters.allocation_rate;
+        stats.free_rate        = counters.free_rate;
+    }
+#endif
 };
 typedef MemoryPoolBase* MemoryPoolPtr;
 
@@ -48,76 +225,301 @@ template<typename T>
 class MemoryPool : public MemoryPoolBase
 {
     friend class MemoryPoolIterator<T>;
+    template<typename U, typename F> friend void for_each_chunk( MemoryPool<U>& pool, F callback );
 
 private:
-    MemoryBlob<T>* first_blob;
-    MemoryBlob<T>* last_blob;
+    // blob directory, blobs[i] holds the elements [i * size, (i+1) * size[
+    std::vector<MemoryBlob<T>*>   blobs;
+    std::vector<MemoryBlobRange> blob_ranges;
+
+    // blobs with at least one free slot, allocation always happens in the last one
+    std::vector<u32> free_blobs;
+
+    // highest generation of each released blob, a blob allocated again at that index starts
+    // from it so the handles to the released elements stay stale
+    std::vector<u32> released_generations;
+
+    // Reserved mode: blobs are laid out back to back in one address range and memory is
+    // committed as they are needed. Blobs never move and iterating is a linear sweep.
+    // Once the range is exhausted new blobs fall back to the heap.
+    u8*  reserved_base       = nullptr;
+    u64  reserved_size       = 0;
+    u64  committed_size      = 0;
+    u32  reserved_blob_count = 0; // these are always the first blobs of the directory
+    bool huge_pages          = false;
+
+    static constexpr u64 blob_stride = sizeof( MemoryBlob<T> );
+
+    // called for each element moved by Compact, old_element must only be used as a key
+    typedef void (*RelocationCallback)( const T* old_element, T* new_element, void* user_data );
+    struct RelocationListener
+    {
+        RelocationCallback callback;
+        void* user_data;
+    };
+    std::vector<RelocationListener> relocation_listeners;
 
-    MemoryBlob<T>* AllocateBlob( MemoryBlob<T>* previous_blob = nullptr )
+    void* AllocateReservedBlob()
     {
-        auto* new_blob = new MemoryBlob<T>();
-        new_blob->next = nullptr;
-        new_blob->high = 0;
-        new_blob->low  = 0;
+        if( reserved_base == nullptr || reserved_blob_count != blobs.size() )
+            return nullptr;
 
-        if( previous_blob )
+        u64 blob_end = ( reserved_blob_count + 1 ) * blob_stride;
+        if( blob_end > reserved_size )
+            return nullptr;
+
+        if( blob_end > committed_size )
         {
-            assert( previous_blob->next == nullptr, "Error: blob chain break.");
-            previous_blob->next = new_blob;
-            if( previous_blob == last_blob )
-                last_blob = new_blob;
+            u64 commit_size = huge_pages ? POOL_HUGE_PAGE_COMMIT_SIZE : POOL_COMMIT_SIZE;
+            u64 new_committed_size = ( blob_end + commit_size - 1 ) / commit_size * commit_size;
+            if( new_committed_size > reserved_size )
+                new_committed_size = reserved_size;
+
+            if( !commit_virtual_memory( reserved_base + committed_size, new_committed_size - committed_size, huge_pages ) )
+                return nullptr;
+            committed_size = new_committed_size;
         }
 
-        return new_blob;
+        return reserved_base + reserved_blob_count++ * blob_stride;
     }
 
-    // @Optimize: Also return the component index
-    T* Instantiate( MemoryBlob<T>* blob )
+    bool IsReservedBlob( const MemoryBlob<T>* blob ) const
     {
-        u32 inst_idx = (std::min)( blob->low, blob->high );
+        return blob->index < reserved_blob_count;
+    }
 
-        u32 allocated_idx  = inst_idx / 8;
-        u8 allocated_mask  = 1 << (inst_idx % 8);
-        assert( ( blob->allocated[ allocated_idx ] & allocated_mask ) == 0, "Error in the algorithm, should not be allocated." );
-        blob->data[inst_idx] = {};
-        blob->allocated[ allocated_idx ] |= allocated_mask;
+    // appends blob_count empty blobs to the directory and the free list
+    void AllocateBlobs( u32 blob_count )
+    {
+        size_t previous_range_count = blob_ranges.size();
+        for( u32 i = 0; i < blob_count; ++i )
+        {
+            void* reserved_memory = AllocateReservedBlob();
+            auto* new_blob = reserved_memory ? new ( reserved_memory ) MemoryBlob<T>() : new MemoryBlob<T>();
+            new_blob->allocated = {};
+            new_blob->count = 0;
+            new_blob->free_word = 0;
+            new_blob->index = (u32)blobs.size();
+            new_blob->generation.fill( new_blob->index < released_generations.size() ? released_generations[ new_blob->index ] : 1 );
+            new_blob->in_free_list = true;
+
+            blobs.push_back( new_blob );
+            free_blobs.push_back( new_blob->index );
+
+            if( !IsReservedBlob( new_blob ) )
+            {
+                blob_ranges.push_back( {
+                    reinterpret_cast<uintptr_t>( new_blob->data.data() ),
+                    reinterpret_cast<uintptr_t>( new_blob->data.data() + new_blob->size() ),
+                    new_blob->index
+                } );
+            }
+        }
 
-        if( blob->low < blob->high )
+        // merge the new ranges once, inserting them one by one would be quadratic
+        auto compare_ranges = []( const MemoryBlobRange& a, const MemoryBlobRange& b ) { return a.begin < b.begin; };
+        auto new_ranges_it = blob_ranges.begin() + previous_range_count;
+        std::sort( new_ranges_it, blob_ranges.end(), compare_ranges );
+        if( new_ranges_it != blob_ranges.begin() && new_ranges_it != blob_ranges.end() && compare_ranges( *new_ranges_it, *( new_ranges_it - 1 ) ) )
+            std::inplace_merge( blob_ranges.begin(), new_ranges_it, blob_ranges.end(), compare_ranges );
+    }
+
+    // @Note: reserved blobs are found with a division, heap blobs with a binary search
+    //        over a contiguous array, a handful of compares even for huge pools. The search
+    //        is branchless, random lookups would mispredict half of its steps.
+    MemoryBlob<T>* FindBlob( const T* obj )
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>( obj );
+        uintptr_t reserved_begin = reinterpret_cast<uintptr_t>( reserved_base );
+        if( address >= reserved_begin && address < reserved_begin + reserved_blob_count * blob_stride )
+            return blobs[ ( address - reserved_begin ) / blob_stride ];
+
+        if( blob_ranges.empty() )
+            return nullptr;
+
+        const MemoryBlobRange* range = blob_ranges.data();
+        for( size_t count = blob_ranges.size(); count > 1; )
         {
-            // searching for a block that is not full
-            while( blob->allocated[ allocated_idx ] == max_value<u8>() ) allocated_idx++;
-            
-            // searching for the bit that is unset
-            u8 allocated_bit = 0;
-            while( ( blob->allocated[allocated_idx] & ( 1 << allocated_bit ) ) > 0 ) allocated_bit++;
-
-            blob->low = allocated_idx * 8 + allocated_bit;
+            size_t half = count / 2;
+            range = range[ half ].begin <= address ? range + half : range;
+            count -= half;
         }
-        else
+
+        if( address < range->begin || address >= range->end )
+            return nullptr;
+
+        return blobs[ range->blob_index ];
+    }
+
+    T* Instantiate( MemoryBlob<T>* blob, u32& blob_idx )
+    {
+        assert( !blob->is_full(), "Error: Tried to instantiate in a full blob." );
+
+        u32 word_idx = blob->free_word;
+        u64 free_bits = ~blob->allocated[ word_idx ] & MemoryBlob<T>::word_mask( word_idx );
+        while( free_bits == 0 )
         {
-            blob->low++;
-            blob->high++;
+            ++word_idx;
+            assert( word_idx < MemoryBlob<T>::word_count, "Error in the algorithm, blob should have a free slot." );
+            free_bits = ~blob->allocated[ word_idx ] & MemoryBlob<T>::word_mask( word_idx );
         }
 
-        return &blob->data[ inst_idx ];
+        u32 bit = count_trailing_zeros( free_bits );
+        blob->allocated[ word_idx ] |= u64(1) << bit;
+        blob->free_word = word_idx;
+        blob->count++;
+
+        blob_idx = word_idx * 64 + bit;
+        blob->data[ blob_idx ] = {};
+        return &blob->data[ blob_idx ];
     }
 
     void Destroy( MemoryBlob<T>* blob, u32 blob_idx )
     {
-        u32 allocated_idx = blob_idx / 8;
-        u8  allocated_mask = 1 << (blob_idx % 8);
-        assert( ( blob->allocated[allocated_idx] & allocated_mask) != 0, "Error: Tried to destroy something not allocated.");
+        assert( blob->is_allocated( blob_idx ), "Error: Tried to destroy something not allocated.");
+
+        u32 word_idx = blob_idx / 64;
+        blob->allocated[ word_idx ] &= ~( u64(1) << ( blob_idx % 64 ) );
+        blob->count--;
 
-        blob->allocated[ allocated_idx ] &= ~allocated_mask;
+        if( ++blob->generation[ blob_idx ] == 0 )
+            blob->generation[ blob_idx ] = 1;
+
+        if( word_idx < blob->free_word ) blob->free_word = word_idx;
+        if( !blob->in_free_list )
+        {
+            blob->in_free_list = true;
+            free_blobs.push_back( blob->index );
+        }
+    }
+
+    // claims up to count free slots of the blob, a whole allocation word at a time,
+    // and appends them to spans, returns the number of slots claimed
+    u32 InstantiateRun( MemoryBlob<T>* blob, u32 count, std::vector<MemoryPoolSpan<T>>& spans )
+    {
+        u32 claimed = 0;
+        for( u32 word_idx = blob->free_word; word_idx < MemoryBlob<T>::word_count && claimed < count; ++word_idx )
+        {
+            u64 free_bits = ~blob->allocated[ word_idx ] & MemoryBlob<T>::word_mask( word_idx );
+            if( free_bits == 0 )
+                continue;
+
+            // last word of the request, only take its lowest free slots
+            u32 wanted = count - claimed;
+            if( count_set_bits( free_bits ) > wanted )
+            {
+                u64 kept_bits = 0;
+                for( u32 i = 0; i < wanted; ++i )
+                {
+                    kept_bits |= free_bits & ( ~free_bits + 1 );
+                    free_bits &= free_bits - 1;
+                }
+                free_bits = kept_bits;
+            }
+
+            blob->allocated[ word_idx ] |= free_bits;
+            blob->free_word = word_idx;
+            claimed += count_set_bits( free_bits );
+
+            while( free_bits != 0 )
+            {
+                u32 start    = count_trailing_zeros( free_bits );
+                u64 ones     = ~( free_bits >> start );
+                u32 length   = ones == 0 ? 64 - start : count_trailing_zeros( ones );
+                u32 blob_idx = word_idx * 64 + start;
+
+                for( u32 i = blob_idx; i < blob_idx + length; ++i )
+                    blob->data[ i ] = {};
+
+                MemoryPoolSpan<T>* last_span = spans.empty() ? nullptr : &spans.back();
+                if( last_span && last_span->data + last_span->count == &blob->data[ blob_idx ] )
+                    last_span->count += length;
+                else
+                    spans.push_back( { &blob->data[ blob_idx ], blob->index * blob->size() + blob_idx, length } );
+
+                free_bits = start + length >= 64 ? 0 : free_bits & ~( ( ( u64(1) << length ) - 1 ) << start );
+            }
+        }
 
-        if( blob_idx < blob->low ) blob->low = blob_idx;
+        blob->count += claimed;
+        return claimed;
+    }
+
+    // destroys the elements [blob_idx, blob_idx + count[ of the blob, clearing whole words
+    void DestroyRun( MemoryBlob<T>* blob, u32 blob_idx, u32 count )
+    {
+        assert( blob_idx + count <= blob->size(), "Error: Tried to destroy a run that goes past its blob." );
+
+        u32 end_idx = blob_idx + count;
+        for( u32 idx = blob_idx; idx < end_idx; )
+        {
+            u32 word_idx = idx / 64;
+            u32 bit      = idx % 64;
+            u32 length   = (std::min)( 64 - bit, end_idx - idx );
+            u64 mask     = ( length == 64 ? ~u64(0) : ( u64(1) << length ) - 1 ) << bit;
+
+            assert( ( blob->allocated[ word_idx ] & mask ) == mask, "Error: Tried to destroy something not allocated." );
+            blob->allocated[ word_idx ] &= ~mask;
+            idx += length;
+        }
+
+        for( u32 idx = blob_idx; idx < end_idx; ++idx )
+        {
+            if( ++blob->generation[ idx ] == 0 )
+                blob->generation[ idx ] = 1;
+        }
+
+        blob->count -= count;
+        if( blob_idx / 64 < blob->free_word ) blob->free_word = blob_idx / 64;
+        if( count > 0 && !blob->in_free_list )
+        {
+            blob->in_free_list = true;
+            free_blobs.push_back( blob->index );
+        }
+    }
+
+    // frees the blobs at the end of the directory, they must be empty
+    void ReleaseBlobs( u32 first_blob_index )
+    {
+        for( u32 blob_index = first_blob_index; blob_index < (u32)blobs.size(); ++blob_index )
+        {
+            MemoryBlob<T>* blob = blobs[ blob_index ];
+            assert( blob->count == 0, "Error: Tried to release a blob that still has elements." );
+
+            // the slots are all free so their generation was never handed out, reusing it is safe
+            if( blob_index >= released_generations.size() )
+                released_generations.resize( blob_index + 1, 1 );
+            u32& released_generation = released_generations[ blob_index ];
+            for( u32 generation : blob->generation )
+                released_generation = (std::max)( released_generation, generation );
+
+            if( IsReservedBlob( blob ) )
+                blob->~MemoryBlob<T>();
+            else
+                delete blob;
+        }
+        blobs.resize( first_blob_index );
+
+        blob_ranges.erase( std::remove_if( blob_ranges.begin(), blob_ranges.end(),
+            [first_blob_index]( const MemoryBlobRange& r ) { return r.blob_index >= first_blob_index; } ), blob_ranges.end() );
+
+        if( reserved_blob_count > first_blob_index )
+        {
+            reserved_blob_count = first_blob_index;
+
+            u64 commit_size = huge_pages ? POOL_HUGE_PAGE_COMMIT_SIZE : POOL_COMMIT_SIZE;
+            u64 needed_size = ( reserved_blob_count * blob_stride + commit_size - 1 ) / commit_size * commit_size;
+            if( needed_size < committed_size )
+            {
+                decommit_virtual_memory( reserved_base + needed_size, committed_size - needed_size );
+                committed_size = needed_size;
+            }
+        }
     }
 
     T* Get( MemoryBlob<T>* blob, u32 blob_idx )
     {
-        u32 allocated_idx = blob_idx / 8;
-        u8  allocated_mask = 1 << (blob_idx % 8);
-        assert( ( blob->allocated[allocated_idx] & allocated_mask) != 0, "Error: Tried to get something not allocated.");
+        assert( blob->is_allocated( blob_idx ), "Error: Tried to get something not allocated.");
 
         return &blob->data[blob_idx];
     }
@@ -125,90 +527,168 @@ private:
 public:
     MemoryPool()
     {
-        first_blob = AllocateBlob();
-        last_blob = first_blob;
+        AllocateBlobs( 1 );
+    }
+
+    MemoryPool( const MemoryPoolConfig& config )
+    {
+        if( config.reserve_size > 0 )
+        {
+            reserved_size = config.reserve_size;
+            huge_pages    = config.huge_pages;
+            reserved_base = static_cast<u8*>( reserve_virtual_memory( reserved_size ) );
+            if( reserved_base == nullptr )
+                println( "WARNING: Failed to reserve % MB for a memory pool, using the heap.", (uint)( reserved_size / ( 1024 * 1024 ) ) );
+        }
+
+        AllocateBlobs( 1 );
     }
 
     ~MemoryPool()
     {
-        auto* blob = first_blob;
-        while( blob )
+        for( auto* blob : blobs )
         {
-            first_blob = blob->next;
-            delete blob;
-            blob = first_blob;
+            if( IsReservedBlob( blob ) )
+                blob->~MemoryBlob<T>();
+            else
+                delete blob;
         }
 
-        first_blob = nullptr;
-        last_blob  = nullptr;
+        if( reserved_base )
+            release_virtual_memory( reserved_base, reserved_size );
+        reserved_base = nullptr;
+        reserved_blob_count = 0;
+
+        blobs.clear();
+        blob_ranges.clear();
+        free_blobs.clear();
     }
 
     T* Instantiate()
     {
-        MemoryBlob<T>* blob = first_blob;
-        while( blob )
-        {
-            if( blob->high >= blob->size() && blob->low >= blob->high )
-            {
-                if( blob == last_blob )
-                    blob = AllocateBlob( last_blob );
-                else
-                    blob = blob->next;
+        u32 idx;
+        return Instantiate( idx );
+    }
 
-                continue;
-            }
+    T* Instantiate( u32& idx )
+    {
+        if( free_blobs.empty() )
+            AllocateBlobs( 1 );
+
+        MemoryBlob<T>* blob = blobs[ free_blobs.back() ];
 
-            return Instantiate( blob );
+        u32 blob_idx;
+        T* inst = Instantiate( blob, blob_idx );
+        if( blob->is_full() )
+        {
+            blob->in_free_list = false;
+            free_blobs.pop_back();
         }
 
-        assert( false, "Error: Failed to allocate an element." ); // @Note: Should never get here...
-        return nullptr;
+        idx = blob->index * blob->size() + blob_idx;
+        POOL_STATS( CountAllocation() );
+        return inst;
     }
 
     void DestroyByIndex( u32 idx ) override
     {
-        MemoryBlob<T>* blob = first_blob;
-        while( blob && idx >= blob->size() )
+        u32 blob_index = idx / get_pool_size<T>();
+        assert( blob_index < blobs.size(), "Error: Tried to destroy something that doesn't belong to any blob.");
+        Destroy( blobs[ blob_index ], idx % get_pool_size<T>() );
+        POOL_STATS( CountFree() );
+    }
+
+    u32 InstantiateByIndex() override
+    {
+        u32 idx;
+        Instantiate( idx );
+        return idx;
+    }
+
+    void Destroy( T* obj )
+    {
+        MemoryBlob<T>* blob = FindBlob( obj );
+        assert( blob != nullptr, "Error: Tried to destroy something that doesn't belong to any blob.");
+
+        Destroy( blob, (u32)( obj - blob->data.data() ) );
+        POOL_STATS( CountFree() );
+    }
+
+    // Claims count elements in one pass, whole allocation words at a time, allocating
+    // all the missing blobs at once. The elements are appended to out_spans as runs of
+    // contiguous slots, in index order within a blob.
+    void InstantiateN( u32 count, std::vector<MemoryPoolSpan<T>>& out_spans )
+    {
+        u32 remaining = count;
+        while( remaining > 0 )
         {
-            idx -= blob->size();
-            blob = blob->next;
+            if( free_blobs.empty() )
+            {
+                // the lowest new blob must be the last of the free list to be filled first
+                u32 new_blob_count = ( remaining + get_pool_size<T>() - 1 ) / get_pool_size<T>();
+                AllocateBlobs( new_blob_count );
+                std::reverse( free_blobs.end() - new_blob_count, free_blobs.end() );
+            }
+
+            MemoryBlob<T>* blob = blobs[ free_blobs.back() ];
+            remaining -= InstantiateRun( blob, remaining, out_spans );
+            if( blob->is_full() )
+            {
+                blob->in_free_list = false;
+                free_blobs.pop_back();
+            }
         }
 
-        assert( blob != nullptr, "Error: Tried to destroy something that doesn't belong to any blob.");
-        Destroy( blob, idx );
+        POOL_STATS( CountAllocation( count ) );
     }
 
-    u32 InstantiateByIndex() override
+    std::vector<MemoryPoolSpan<T>> InstantiateN( u32 count )
     {
-        auto inst = Instantiate();
-        return IndexOf( inst );
+        std::vector<MemoryPoolSpan<T>> spans;
+        InstantiateN( count, spans );
+        return spans;
     }
 
-    void Destroy( T* obj )
+    void DestroyN( const MemoryPoolSpan<T>* spans, u32 span_count )
     {
-        MemoryBlob<T>* blob = first_blob;
-        i32 idx = (i32) ( obj - blob->data.data() );
-        while( blob && !( idx >= 0 && (u32)idx < blob->size()) )
+        for( u32 span_idx = 0; span_idx < span_count; ++span_idx )
         {
-            blob = blob->next;
-            idx = (i32) ( obj - blob->data.data() );
+            const MemoryPoolSpan<T>& span = spans[ span_idx ];
+            u32 blob_index = span.first_index / get_pool_size<T>();
+            assert( blob_index < blobs.size(), "Error: Tried to destroy something that doesn't belong to any blob.");
+            DestroyRun( blobs[ blob_index ], span.first_index % get_pool_size<T>(), span.count );
+            POOL_STATS( CountFree( span.count ) );
         }
-        assert( blob != nullptr, "Error: Tried to destroy something that doesn't belong to any blob.");
+    }
 
-        Destroy( blob, idx );
+    void DestroyN( const std::vector<MemoryPoolSpan<T>>& spans )
+    {
+        DestroyN( spans.data(), (u32)spans.size() );
     }
 
-    T* Get( u32 idx )
+    // destroys the elements [first_index, first_index + count[, they must all be live
+    void DestroyN( u32 first_index, u32 count )
     {
-        MemoryBlob<T>* blob = first_blob;
-        while( blob && idx >= blob->size() )
+        u32 end_index = first_index + count;
+        for( u32 idx = first_index; idx < end_index; )
         {
-            idx -= blob->size();
-            blob = blob->next;
+            u32 blob_index = idx / get_pool_size<T>();
+            assert( blob_index < blobs.size(), "Error: Tried to destroy something that doesn't belong to any blob.");
+
+            u32 blob_idx = idx % get_pool_size<T>();
+            u32 length   = (std::min)( get_pool_size<T>() - blob_idx, end_index - idx );
+            DestroyRun( blobs[ blob_index ], blob_idx, length );
+            idx += length;
         }
 
-        assert( blob != nullptr, "Error: Tried to get something that doesn't belong to this pool." );
-        return Get( blob, idx );
+        POOL_STATS( CountFree( count ) );
+    }
+
+    T* Get( u32 idx )
+    {
+        u32 blob_index = idx / get_pool_size<T>();
+        assert( blob_index < blobs.size(), "Error: Tried to get something that doesn't belong to this pool." );
+        return Get( blobs[ blob_index ], idx % get_pool_size<T>() );
     }
 
     virtual void* GetRaw( u32 idx )
@@ -218,19 +698,156 @@ public:
 
     u32 IndexOf( const T* obj )
     {
-        MemoryBlob<T>* blob = first_blob;
-        i32 total_idx = 0;
-        i32 idx = (i32) ( obj - blob->data.data() );
-        while( blob && !( idx >= 0 && idx < (i32)blob->size()) )
+        MemoryBlob<T>* blob = FindBlob( obj );
+        assert( blob != nullptr, "Error: Tried to get the index of something that doesn't belong to this pool." );
+
+        return blob->index * blob->size() + (u32)( obj - blob->data.data() );
+    }
+
+    PoolHandle HandleOf( const T* obj )
+    {
+        MemoryBlob<T>* blob = FindBlob( obj );
+        assert( blob != nullptr, "Error: Tried to get the handle of something that doesn't belong to this pool." );
+
+        u32 blob_idx = (u32)( obj - blob->data.data() );
+        return make_pool_handle( blob->index * blob->size() + blob_idx, blob->generation[ blob_idx ] );
+    }
+
+    // returns nullptr if the handle is stale or doesn't belong to this pool
+    T* TryGet( PoolHandle handle )
+    {
+        u32 idx = get_pool_handle_index( handle );
+        u32 blob_index = idx / get_pool_size<T>();
+        if( blob_index >= blobs.size() )
+            return nullptr;
+
+        MemoryBlob<T>* blob = blobs[ blob_index ];
+        u32 blob_idx = idx % get_pool_size<T>();
+        if( !blob->is_allocated( blob_idx ) || blob->generation[ blob_idx ] != get_pool_handle_generation( handle ) )
+            return nullptr;
+
+        return &blob->data[ blob_idx ];
+    }
+
+    bool IsValid( PoolHandle handle )
+    {
+        return TryGet( handle ) != nullptr;
+    }
+
+    void* TryGetRaw( PoolHandle handle ) override
+    {
+        return static_cast<void*>( TryGet( handle ) );
+    }
+
+    // @Note: Checked in release too, a stale handle would destroy whatever reused its slot.
+    bool DestroyByHandle( PoolHandle handle ) override
+    {
+        if( !IsValid( handle ) )
+            return false;
+
+        DestroyByIndex( get_pool_handle_index( handle ) );
+        return true;
+    }
+
+    PoolHandle InstantiateByHandle() override
+    {
+        u32 idx;
+        Instantiate( idx );
+
+        MemoryBlob<T>* blob = blobs[ idx / get_pool_size<T>() ];
+        return make_pool_handle( idx, blob->generation[ idx % get_pool_size<T>() ] );
+    }
+
+    MemoryPoolStats GetStats() override
+    {
+        MemoryPoolStats stats;
+        stats.element_size = sizeof(T);
+        stats.blob_count   = (u32)blobs.size();
+        stats.capacity     = stats.blob_count * get_pool_size<T>();
+        for( auto* blob : blobs )
+            stats.live_count += blob->count;
+
+        u32 needed_blob_count = (std::max)( 1u, ( stats.live_count + get_pool_size<T>() - 1 ) / get_pool_size<T>() );
+        stats.fill_ratio    = stats.capacity > 0 ? (f32)stats.live_count / stats.capacity : 0.0f;
+        stats.fragmentation = stats.blob_count > 0 ? 1.0f - (f32)needed_blob_count / stats.blob_count : 0.0f;
+        POOL_STATS( FillCounterStats( stats ) );
+
+        return stats;
+    }
+
+    void RegisterRelocationCallback( RelocationCallback callback, void* user_data = nullptr )
+    {
+        relocation_listeners.push_back( { callback, user_data } );
+    }
+
+    void UnregisterRelocationCallback( RelocationCallback callback, void* user_data = nullptr )
+    {
+        relocation_listeners.erase( std::remove_if( relocation_listeners.begin(), relocation_listeners.end(),
+            [=]( const RelocationListener& l ) { return l.callback == callback && l.user_data == user_data; } ),
+            relocation_listeners.end() );
+    }
+
+    // Moves the live elements into the fewest blobs possible and releases the empty ones.
+    // Elements are moved from the last blobs into the holes of the first ones, so the
+    // elements that already fit stay where they are. Pointers to moved elements are
+    // invalidated: fix them with the registered callbacks, or remap handles with the
+    // returned relocations.
+    std::vector<MemoryPoolRelocation> Compact()
+    {
+        std::vector<MemoryPoolRelocation> relocations;
+
+        u32 live_count = 0;
+        for( auto* blob : blobs )
+            live_count += blob->count;
+
+        u32 kept_blob_count = (std::max)( 1u, ( live_count + get_pool_size<T>() - 1 ) / get_pool_size<T>() );
+        if( kept_blob_count >= (u32)blobs.size() )
+            return relocations;
+
+        u32 dst_blob_index = 0;
+        for( u32 src_blob_index = kept_blob_count; src_blob_index < (u32)blobs.size(); ++src_blob_index )
         {
-            blob = blob->next;
-            idx = (i32) ( obj - blob->data.data() );
-            total_idx += blob->size();
+            MemoryBlob<T>* src_blob = blobs[ src_blob_index ];
+            for( u32 word_idx = 0; word_idx < MemoryBlob<T>::word_count && src_blob->count > 0; ++word_idx )
+            {
+                u64 bits = src_blob->allocated[ word_idx ];
+                while( bits != 0 )
+                {
+                    u32 src_idx = word_idx * 64 + count_trailing_zeros( bits );
+                    bits &= bits - 1;
+
+                    while( blobs[ dst_blob_index ]->is_full() )
+                        ++dst_blob_index;
+                    assert( dst_blob_index < kept_blob_count, "Error in the algorithm, kept blobs should have room left." );
+                    MemoryBlob<T>* dst_blob = blobs[ dst_blob_index ];
+
+                    PoolHandle old_handle = make_pool_handle( src_blob->index * src_blob->size() + src_idx, src_blob->generation[ src_idx ] );
+
+                    u32 dst_idx;
+                    T* dst = Instantiate( dst_blob, dst_idx );
+                    T* src = &src_blob->data[ src_idx ];
+                    *dst = std::move( *src );
+                    Destroy( src_blob, src_idx );
+
+                    relocations.push_back( { old_handle, make_pool_handle( dst_blob->index * dst_blob->size() + dst_idx, dst_blob->generation[ dst_idx ] ) } );
+                    for( auto& listener : relocation_listeners )
+                        listener.callback( src, dst, listener.user_data );
+                }
+            }
         }
-        assert( blob != nullptr, "Error: Tried to get the index of something that doesn't belong to this pool." );
 
-        total_idx += idx;
-        return total_idx;
+        ReleaseBlobs( kept_blob_count );
+
+        free_blobs.clear();
+        for( auto* blob : blobs )
+        {
+            blob->free_word = 0;
+            blob->in_free_list = !blob->is_full();
+            if( blob->in_free_list )
+                free_blobs.push_back( blob->index );
+        }
+
+        return relocations;
     }
 
     MemoryPoolIterator<T> begin()
@@ -240,77 +857,57 @@ public:
 
     MemoryPoolIterator<T> end()
     {
-        return MemoryPoolIterator<T>( nullptr );
+        return MemoryPoolIterator<T>( *this, max_value<u32>() );
     }
 };
 
+// Walks the live elements by scanning the allocation words, empty blobs are skipped
+// by looking at their count only.
 template<typename T>
 class MemoryPoolIterator
 {
 private:
-    MemoryBlob<T>* current_blob = nullptr;
-    u32         current_blob_allocated_idx  = 0;
-    u8          current_blob_allocated_bit = 0;
+    MemoryPool<T>* pool = nullptr;
+    u32 blob_index = 0;
+    u32 word_idx   = 0;
+    u64 word_bits  = 0; // bits of the current word not visited yet
+    u32 blob_idx   = 0;
 
 public:
     MemoryPoolIterator( MemoryPool<T>& pool )
-        : current_blob( pool.first_blob )
+        : pool( &pool )
     {
-        if( current_blob && !is_valid() )
-            ++(*this);
+        word_bits = current_blob()->allocated[0];
+        if( current_blob()->count == 0 )
+            next_blob();
+        else
+            seek();
     }
 
-    MemoryPoolIterator( MemoryBlob<T>* blob )
-        : current_blob( blob )
+    MemoryPoolIterator( MemoryPool<T>& pool, u32 blob_index )
+        : pool( &pool ), blob_index( blob_index )
     {
-        if( current_blob && !is_valid() )
-            ++(*this);
     }
 
     MemoryPoolIterator<T> operator++()
     {
-        next();
-        while( current_blob && !is_valid() )
-            next();
-
-        return *this;
-    }
-
-    void next()
-    {
-        assert( current_blob != nullptr, "Error: Called next with no current_blob." );
+        assert( blob_index != max_value<u32>(), "Error: Incremented an iterator past the end." );
 
-        if( current_blob_allocated_bit == 8 )
-        {
-            current_blob_allocated_bit = 0;
-            current_blob_allocated_idx += 1;
-        }
-        else
-        {
-            current_blob_allocated_bit += 1;
-        }
+        word_bits &= word_bits - 1;
+        seek();
 
-        if( ( current_blob_allocated_idx * 8 >= current_blob->high ) || ( current_blob_allocated_idx * 8 >= current_blob->size() ) )
-        {
-            current_blob_allocated_bit = 0;
-            current_blob_allocated_idx = 0;
-            current_blob = current_blob->next;
-        }
+        return *this;
     }
 
-    bool is_valid()
+    MemoryBlob<T>* current_blob() const
     {
-        if( current_blob == nullptr || ( current_blob_allocated_idx * 8 ) > current_blob->size() )
-            return false;
-
-        return ( current_blob->allocated[ current_blob_allocated_idx ] & (1 << current_blob_allocated_bit) ) > 0;
+        return pool->blobs[ blob_index ];
     }
 
     bool operator==( const MemoryPoolIterator<T>& other ) const
     {
-        return ( this->current_blob == other.current_blob )
-                && ( this->current_blob_allocated_idx == other.current_blob_allocated_idx )
-                && ( this->current_blob_allocated_bit == other.current_blob_allocated_bit );
+        return ( this->blob_index == other.blob_index )
+                && ( this->blob_idx == other.blob_idx );
     }
 
     bool operator!=( const MemoryPoolIterator<T>& other ) const
@@ -320,13 +917,95 @@ public:
 
     T* operator*() const
     {
-        assert( current_blob, "Error: Dereferencing itertor while current_blob is null." );
-        return &current_blob->data[ current_blob_allocated_idx * 8 + current_blob_allocated_bit ];
+        assert( blob_index != max_value<u32>(), "Error: Dereferencing itertor past the end." );
+        return &current_blob()->data[ blob_idx ];
     }
 
     T* operator->() const
     {
-        assert( current_blob, "Error: Dereferencing itertor while current_blob is null." );
-        return &current_blob->data[ current_blob_allocated_idx * 8 + current_blob_allocated_bit ];
+        assert( blob_index != max_value<u32>(), "Error: Dereferencing itertor past the end." );
+        return &current_blob()->data[ blob_idx ];
+    }
+
+private:
+    // moves to the lowest bit left in word_bits, or to the next non empty word
+    void seek()
+    {
+        while( word_bits == 0 )
+        {
+            if( ++word_idx >= MemoryBlob<T>::word_count )
+            {
+                next_blob();
+                return;
+            }
+            word_bits = current_blob()->allocated[ word_idx ];
+        }
+
+        blob_idx = word_idx * 64 + count_trailing_zeros( word_bits );
+    }
+
+    void next_blob()
+    {
+        u32 blob_count = (u32)pool->blobs.size();
+        do
+        {
+            ++blob_index;
+        } while( blob_index < blob_count && pool->blobs[ blob_index ]->count == 0 );
+
+        word_idx = 0;
+        blob_idx = 0;
+        if( blob_index >= blob_count )
+        {
+            blob_index = max_value<u32>();
+            word_bits  = 0;
+            return;
+        }
+
+        word_bits = current_blob()->allocated[0];
+        seek();
     }
 };
+
+// Calls callback( T* first, u32 count ) for each run of contiguous live elements
+// of the pool, runs never span two blobs.
+template<typename T, typename F>
+void for_each_chunk( MemoryPool<T>& pool, F callback )
+{
+    for( u32 blob_index = 0; blob_index < (u32)pool.blobs.size(); ++blob_index )
+    {
+        MemoryBlob<T>* blob = pool.blobs[ blob_index ];
+        if( blob->count == 0 )
+            continue;
+
+        u32 run_start  = 0;
+        u32 run_length = 0;
+        for( u32 word_idx = 0; word_idx < MemoryBlob<T>::word_count; ++word_idx )
+        {
+            u64 bits = blob->allocated[ word_idx ];
+            while( bits != 0 )
+            {
+                u32 start   = count_trailing_zeros( bits );
+                u64 ones    = ~( bits >> start );
+                u32 length  = ones == 0 ? 64 - start : count_trailing_zeros( ones );
+                u32 slot    = word_idx * 64 + start;
+
+                if( run_length > 0 && run_start + run_length == slot )
+                {
+                    run_length += length;
+                }
+                else
+                {
+                    if( run_length > 0 )
+                        callback( &blob->data[ run_start ], run_length );
+                    run_start  = slot;
+                    run_length = length;
+                }
+
+                bits = start + length >= 64 ? 0 : bits & ~( ( ( u64(1) << length ) - 1 ) << start );
+            }
+        }
+
+        if( run_length > 0 )
+            callback( &blob->data[ run_start ], run_length );
+    }
+}
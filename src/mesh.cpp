@@ -1,12 +1,72 @@
 #include "mesh.h"
 
 #include "basics.h"
+#include "resource_pool.h"
+#include "type_db.h"
+#include "resource_loader.h"
+#include "resource_budget.h"
+#include "asset_archive.h"
+#include "decode_cache.h"
+#include "resource_dependencies.h"
+#include "load_telemetry.h"
+#include "dll.h"
 
 /* assimp include files. These three are usually needed. */
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+REGISTER_RESOURCE_POOL( MeshDef );
+
+// meshes are drawn from the CPU arrays, nothing is on the GPU
+static void update_mesh_memory( MeshDef* def )
+{
+    set_resource_memory( def, (u64)def->vertex_count * sizeof(Vertex) + (u64)def->index_count * sizeof(uint), 0 );
+}
+
+// the only place the arrays are released, evictions, reloads and destroy_meshdef all go through it
+static void free_mesh_arrays( MeshDef* def )
+{
+    if( !def->borrowed_from_archive )
+    {
+        delete[] def->vertices;
+        delete[] def->indices;
+    }
+
+    def->vertices     = nullptr;
+    def->vertex_count = 0;
+    def->indices      = nullptr;
+    def->index_count  = 0;
+    def->borrowed_from_archive = false;
+}
+
+// every write to the arrays goes through these, a borrowed array is in a read only mapping and would fault
+static Vertex* get_writable_vertices( MeshDef& def )
+{
+    assert( !def.borrowed_from_archive, "Error: Tried to write the vertices of a mesh borrowed from the asset archive." );
+    return def.vertices;
+}
+
+static uint* get_writable_indices( MeshDef& def )
+{
+    assert( !def.borrowed_from_archive, "Error: Tried to write the indices of a mesh borrowed from the asset archive." );
+    return def.indices;
+}
+
+// @Note: The arrays point into the read only mapping of the archive, the const is dropped for the
+//        fields only. Packed meshes are never edited in place, see get_writable_vertices.
+static void assign_archived_mesh( MeshDef* def, const ArchiveEntry* entry )
+{
+    free_mesh_arrays( def );
+
+    auto data = get_archive_data( entry );
+    def->vertex_count = entry->params[0];
+    def->index_count  = entry->params[1];
+    def->vertices     = reinterpret_cast<Vertex*>( const_cast<u8*>( data ) );
+    def->indices      = reinterpret_cast<uint*>( const_cast<u8*>( data ) + def->vertex_count * sizeof(Vertex) );
+    def->borrowed_from_archive = true;
+}
+
 static const struct aiMesh* find_first_mesh( const struct aiScene* scene, const struct aiNode* node )
 {
     if( node == nullptr )
@@ -46,14 +106,8 @@ MeshDef make_meshdef( uint vertex_count, uint index_count )
 
 void destroy_meshdef( MeshDef* meshdef )
 {
-    delete[] meshdef->indices;
-    delete[] meshdef->vertices;
-
-    meshdef->indices = nullptr;
-    meshdef->index_count = 0;
-    meshdef->vertices = nullptr;
-    meshdef->vertex_count = 0;
-
+    free_mesh_arrays( meshdef );
+    update_mesh_memory( meshdef );
     clear_resource( meshdef );
 }
 
@@ -63,20 +117,24 @@ MeshDef* load_mesh_from_data( MemoryPool<MeshDef>& mesh_pool, const char* name,
     *def = make_meshdef( (uint)vertices.size(), (uint)indices.size() );
     setup_resource( def, nullptr, name );
 
-    memcpy( def->vertices, vertices.data(), vertices.size() * sizeof(Vertex) );
-    memcpy( def->indices, indices.data(), indices.size() * sizeof(uint) );
+    memcpy( get_writable_vertices( *def ), vertices.data(), vertices.size() * sizeof(Vertex) );
+    memcpy( get_writable_indices( *def ), indices.data(), indices.size() * sizeof(uint) );
+    update_mesh_memory( def );
 
     return def;
 }
 
-MeshDef* load_mesh( MemoryPool<MeshDef>& mesh_pool, const char* file_path )
+#define MESH_IMPORT_FLAGS   ( aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_Triangulate | aiProcess_MakeLeftHanded )
+#define MESH_DECODE_VERSION 1 // bump when the conversion below changes
+
+static bool import_mesh( const char* file_path, MeshDef& def, std::string& name )
 {
-    const struct aiScene* scene = aiImportFile( file_path, aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_Triangulate | aiProcess_MakeLeftHanded );
+    const struct aiScene* scene = aiImportFile( file_path, MESH_IMPORT_FLAGS );
 
     if( scene == nullptr )
     {
         println("Error: Couldn't load file %", file_path);
-        return nullptr;
+        return false;
     }
 
     // @TODO: For now we're only going to load the first mesh we find for conveniency... Maybe return a list of MeshDef at one point ?
@@ -84,25 +142,27 @@ MeshDef* load_mesh( MemoryPool<MeshDef>& mesh_pool, const char* file_path )
     if( mesh == nullptr )
     {
         println("Error: No mesh found in file %", file_path);
-        return nullptr;
+        aiReleaseImport( scene );
+        return false;
     }
 
-    MeshDef* def = mesh_pool.Instantiate();
-    *def = make_meshdef( mesh->mNumVertices, mesh->mNumFaces * 3 );
-    setup_resource( def, file_path, mesh->mName.C_Str() );
+    def = make_meshdef( mesh->mNumVertices, mesh->mNumFaces * 3 );
+    name = mesh->mName.C_Str();
 
     auto blender_adaption_matrix = Matrix4::RotationMatrix( 90, Vector3::Right() );
 
+    Vertex* vertices = get_writable_vertices( def );
     for( uint vertex = 0; vertex < mesh->mNumVertices; ++vertex )
     {
-        def->vertices[vertex].position = { mesh->mVertices[vertex].x, mesh->mVertices[vertex].y, mesh->mVertices[vertex].z };
-        def->vertices[vertex].position = blender_adaption_matrix.Apply( def->vertices[vertex].position );
+        vertices[vertex].position = { mesh->mVertices[vertex].x, mesh->mVertices[vertex].y, mesh->mVertices[vertex].z };
+        vertices[vertex].position = blender_adaption_matrix.Apply( vertices[vertex].position );
         if( mesh->mColors[0] != nullptr )
-            def->vertices[vertex].color = { mesh->mColors[0][vertex][0], mesh->mColors[0][vertex][1], mesh->mColors[0][vertex][2], mesh->mColors[0][vertex][3] };
+            vertices[vertex].color = { mesh->mColors[0][vertex][0], mesh->mColors[0][vertex][1], mesh->mColors[0][vertex][2], mesh->mColors[0][vertex][3] };
         if( mesh->mNormals != nullptr )
-            def->vertices[vertex].normal = { mesh->mNormals[vertex].x, mesh->mNormals[vertex].y, mesh->mNormals[vertex].z };
+            vertices[vertex].normal = { mesh->mNormals[vertex].x, mesh->mNormals[vertex].y, mesh->mNormals[vertex].z };
     }
 
+    uint* indices = get_writable_indices( def );
     uint index  = 0;
     for( uint i=0; i<mesh->mNumFaces; ++i )
     {
@@ -110,11 +170,194 @@ MeshDef* load_mesh( MemoryPool<MeshDef>& mesh_pool, const char* file_path )
         assert( face.mNumIndices == 3, "Only support triangle or polygon faces." );
         for( uint j=0; j<3; ++j )
         {
-            def->indices[index] = face.mIndices[j];
+            indices[index] = face.mIndices[j];
             ++index;
         }
     }
 
+    aiReleaseImport( scene );
+    return true;
+}
+
+// @Note: Only the mesh file is hashed, files it references (materials) don't invalidate the entry.
+bool decode_mesh( const char* file_path, MeshDef& def, std::string& name )
+{
+    u64 key;
+    {
+        LoadPhaseTimer read_timer( file_path, LoadPhase::READ );
+        MappedFile source;
+        if( !map_file( file_path, source ) )
+        {
+            println("Error: Couldn't load file %", file_path);
+            return false;
+        }
+
+        key = get_decode_cache_key( source.data, source.size, (u64)MESH_IMPORT_FLAGS | ( (u64)MESH_DECODE_VERSION << 32 ) );
+        read_timer.bytes = source.size;
+        unmap_file( source );
+    }
+
+    // @Note: On a miss assimp reads the file again, that read is counted in the decode.
+    LoadPhaseTimer decode_timer( file_path, LoadPhase::DECODE );
+
+    DecodeCacheEntry entry;
+    if( open_decode_cache_entry( key, entry ) )
+    {
+        auto params = entry.header->params;
+        if( entry.header->data_size == (u64)params[0] * sizeof(Vertex) + (u64)params[1] * sizeof(uint) + params[2] )
+        {
+            def = make_meshdef( params[0], params[1] );
+
+            const u8* data = entry.data;
+            memcpy( get_writable_vertices( def ), data, params[0] * sizeof(Vertex) );
+            data += params[0] * sizeof(Vertex);
+            memcpy( get_writable_indices( def ), data, params[1] * sizeof(uint) );
+            data += params[1] * sizeof(uint);
+            name.assign( reinterpret_cast<const char*>( data ), params[2] );
+
+            close_decode_cache_entry( entry );
+            return true;
+        }
+        close_decode_cache_entry( entry );
+    }
+
+    if( !import_mesh( file_path, def, name ) )
+        return false;
+
+    u32 params[4] = { def.vertex_count, def.index_count, (u32)name.size(), 0 };
+    write_decode_cache_entry( key, params, {
+        { def.vertices, def.vertex_count * sizeof(Vertex) },
+        { def.indices, def.index_count * sizeof(uint) },
+        { name.data(), name.size() } } );
+    return true;
+}
+
+MeshDef* load_mesh( MemoryPool<MeshDef>& mesh_pool, const char* file_path )
+{
+    if( auto entry = find_archive_entry( file_path, ArchiveEntryKind::MESH ) )
+    {
+        MeshDef* def = mesh_pool.Instantiate();
+        assign_archived_mesh( def, entry );
+        setup_resource( def, file_path, get_archive_entry_name( entry ).c_str() );
+        update_mesh_memory( def );
+        def->loaded = true;
+        return def;
+    }
+
+    MeshDef decoded;
+    std::string name;
+    if( !decode_mesh( file_path, decoded, name ) )
+        return nullptr;
+
+    MeshDef* def = mesh_pool.Instantiate();
+    *def = decoded;
+    setup_resource( def, file_path, name.c_str() );
+    update_mesh_memory( def );
+    def->loaded = true;
+
     return def;
 }
 
+struct DecodedMesh
+{
+    MeshDef     def;
+    std::string name;
+};
+
+static void decode_mesh_job( ResourceLoadJob& job )
+{
+    auto decoded = new DecodedMesh();
+    if( decode_mesh( job.path.c_str(), decoded->def, decoded->name ) )
+        job.decoded = decoded;
+    else
+        delete decoded;
+}
+
+static void finalize_mesh_job( ResourceLoadJob& job )
+{
+    auto& resource_pool = get_dll_appdata().global_store.resource_pool;
+    auto decoded = static_cast<DecodedMesh*>( job.decoded );
+    auto def = get_resource<MeshDef>( resource_pool, job.resource );
+    if( decoded == nullptr )
+    {
+        // a failed reload keeps the previous mesh, a failed first load had nothing to keep
+        if( def != nullptr && def->source == nullptr )
+        {
+            destroy_meshdef( def );
+            get_resource_pool<MeshDef>( resource_pool ).Destroy( def );
+        }
+        return;
+    }
+
+    if( def == nullptr )
+    {
+        delete[] decoded->def.vertices;
+        delete[] decoded->def.indices;
+    }
+    else
+    {
+        free_mesh_arrays( def );
+
+        def->vertices     = decoded->def.vertices;
+        def->vertex_count = decoded->def.vertex_count;
+        def->indices      = decoded->def.indices;
+        def->index_count  = decoded->def.index_count;
+        setup_resource( def, job.path.c_str(), decoded->name.c_str() );
+        update_mesh_memory( def );
+        def->loaded  = true;
+        def->evicted = false;
+        invalidate_dependents( def );
+    }
+
+    delete decoded;
+}
+
+static void queue_mesh_load( MeshDef* def, const char* file_path )
+{
+    // packed meshes are used in place, nothing to decode
+    if( auto entry = find_archive_entry( file_path, ArchiveEntryKind::MESH ) )
+    {
+        assign_archived_mesh( def, entry );
+        setup_resource( def, file_path, get_archive_entry_name( entry ).c_str() );
+        update_mesh_memory( def );
+        def->loaded  = true;
+        def->evicted = false;
+        return;
+    }
+
+    ResourceLoadJob job;
+    job.resource = get_resource_handle( get_dll_appdata().global_store.resource_pool, def );
+    job.path     = file_path;
+    job.decode   = &decode_mesh_job;
+    job.finalize = &finalize_mesh_job;
+    queue_resource_load( job );
+}
+
+// the mesh gets its name once decoded, until then it can't be found by name
+ResourceHandle load_mesh_async( MemoryPool<MeshDef>& mesh_pool, const char* file_path )
+{
+    MeshDef* def = mesh_pool.Instantiate();
+    queue_mesh_load( def, file_path );
+    return get_resource_handle( get_dll_appdata().global_store.resource_pool, def );
+}
+
+// the previous vertices stay in use until the new ones are decoded
+static void reload_mesh( Resource* resource )
+{
+    queue_mesh_load( static_cast<MeshDef*>( resource ), resolve_string( resource->source->source ) );
+}
+REGISTER_RESOURCE_RELOADER( MeshDef, reload_mesh );
+
+// the arrays are the whole mesh, it comes back through reload_mesh on next use
+static void evict_mesh( Resource* resource, ResourceMemory memory )
+{
+    if( memory != ResourceMemory::CPU )
+        return;
+
+    auto def = static_cast<MeshDef*>( resource );
+    free_mesh_arrays( def );
+    update_mesh_memory( def );
+    def->loaded  = false;
+    def->evicted = true;
+}
+REGISTER_RESOURCE_EVICTOR( MeshDef, evict_mesh );
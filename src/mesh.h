@@ -3,6 +3,7 @@
 #include "resource.h"
 #include "mathlib.h"
 #include "memory_pool.h"
+#include "resource_pool.h"
 
 struct Vertex 
 {
@@ -16,18 +17,22 @@ struct MeshDef : public Resource
 {
     GENERATE_BODY( MeshDef );
 
+    // owned, or in the read only asset archive when borrowed_from_archive is set
     Vertex* vertices     = nullptr;
     uint    vertex_count = 0;
 
     uint*   indices     = nullptr;
     uint    index_count = 0;
 };
+template<> constexpr u32 get_pool_size<MeshDef>() { return get_page_fitting_pool_size<MeshDef>(); }
 
 MeshDef  make_meshdef( uint vertex_count, uint index_count );
+bool     decode_mesh( const char* file_path, MeshDef& def, std::string& name ); // no pool or GL, safe on a loader worker or in the packer
 void     destroy_meshdef( MeshDef* meshdef );
 
 MeshDef* load_mesh_from_data( MemoryPool<MeshDef>& mesh_pool, const char* name, const std::vector<Vertex>& vertices, const std::vector<uint>& indices );
-MeshDef* load_mesh( MemoryPool<MeshDef>& mesh_pool, const char* file );
+MeshDef* load_mesh( MemoryPool<MeshDef>& mesh_pool, const char* file ); // uses the asset archive when the file is packed
+ResourceHandle load_mesh_async( MemoryPool<MeshDef>& mesh_pool, const char* file ); // loaded is set once decoded, the handle goes stale if it can't be
 
 
 /* @Improvements: Might reuse this if we want to pack things better...
@@ -0,0 +1,99 @@
+#include "name_index.h"
+
+#include "basics.h"
+
+#define NAME_INDEX_MIN_CAPACITY 64
+
+// FNV-1a
+u64 hash_name( const char* name )
+{
+    u64 hash = 14695981039346656037ull;
+    for( const char* c = name; *c != '\0'; ++c )
+    {
+        hash ^= (u8)*c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+u64 hash_name( const char* name, u32 length )
+{
+    u64 hash = 14695981039346656037ull;
+    for( u32 i = 0; i < length; ++i )
+    {
+        hash ^= (u8)name[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void NameIndex::Rehash( u32 new_capacity )
+{
+    std::vector<Entry> previous_entries;
+    previous_entries.swap( entries );
+    entries.resize( new_capacity );
+    tombstones = 0;
+
+    u32 mask = new_capacity - 1;
+    for( const Entry& entry : previous_entries )
+    {
+        if( entry.value == nullptr || entry.value == tombstone() )
+            continue;
+
+        u32 slot = (u32)entry.hash & mask;
+        while( entries[ slot ].value != nullptr )
+            slot = ( slot + 1 ) & mask;
+        entries[ slot ] = entry;
+    }
+}
+
+void NameIndex::Insert( u64 hash, void* value )
+{
+    assert( value != nullptr && value != tombstone(), "NameIndex: invalid value." );
+
+    // keep at least a quarter of the slots empty so probes stay short
+    if( ( count + tombstones + 1 ) * 4 > (u32)entries.size() * 3 )
+    {
+        u32 new_capacity = entries.empty() ? NAME_INDEX_MIN_CAPACITY : (u32)entries.size();
+        while( ( count + 1 ) * 2 > new_capacity )
+            new_capacity *= 2;
+        Rehash( new_capacity );
+    }
+
+    u32 mask = (u32)entries.size() - 1;
+    u32 slot = (u32)hash & mask;
+    while( entries[ slot ].value != nullptr && entries[ slot ].value != tombstone() )
+        slot = ( slot + 1 ) & mask;
+
+    if( entries[ slot ].value == tombstone() )
+        tombstones--;
+    entries[ slot ] = { hash, value };
+    count++;
+}
+
+bool NameIndex::Remove( u64 hash, void* value )
+{
+    if( count == 0 )
+        return false;
+
+    u32 mask = (u32)entries.size() - 1;
+    for( u32 slot = (u32)hash & mask; entries[ slot ].value != nullptr; slot = ( slot + 1 ) & mask )
+    {
+        Entry& entry = entries[ slot ];
+        if( entry.hash == hash && entry.value == value )
+        {
+            entry.value = tombstone();
+            count--;
+            tombstones++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void NameIndex::Clear()
+{
+    entries.clear();
+    count      = 0;
+    tombstones = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "basic_types.h"
+
+u64 hash_name( const char* name );
+u64 hash_name( const char* name, u32 length );
+
+// Open addressing table from a precomputed name hash to the element holding the name,
+// linear probing over a power of two capacity. Names are never stored: on a hash match
+// the caller's predicate compares the actual name, so collisions and duplicated names
+// are fine. Removed entries leave a tombstone until the next rehash.
+class NameIndex
+{
+private:
+    struct Entry
+    {
+        u64   hash  = 0;
+        void* value = nullptr; // nullptr is an empty slot
+    };
+
+    std::vector<Entry> entries;
+    u32 count      = 0;
+    u32 tombstones = 0;
+
+    void Rehash( u32 new_capacity );
+
+public:
+    void Insert( u64 hash, void* value );
+    bool Remove( u64 hash, void* value ); // false if the value wasn't indexed under this hash
+    void Clear();
+
+    u32 Count() const { return count; }
+
+    // first value with this hash for which matches( value ) is true, nullptr otherwise
+    template<typename F>
+    void* Find( u64 hash, F matches ) const
+    {
+        if( count == 0 )
+            return nullptr;
+
+        u32 mask = (u32)entries.size() - 1;
+        for( u32 slot = (u32)hash & mask; entries[ slot ].value != nullptr; slot = ( slot + 1 ) & mask )
+        {
+            const Entry& entry = entries[ slot ];
+            if( entry.hash == hash && entry.value != tombstone() && matches( entry.value ) )
+                return entry.value;
+        }
+        return nullptr;
+    }
+
+    static void* tombstone() { return reinterpret_cast<void*>( ~uintptr_t(0) ); }
+};
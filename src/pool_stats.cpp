@@ -0,0 +1,115 @@
+#include "pool_stats.h"
+
+#include <imgui.h>
+#include <fstream>
+
+#include "appdata.h"
+
+#define POOL_STATS_SAMPLE_PERIOD 1.0
+
+template<typename F>
+static void for_each_pool( Appdata& appdata, F callback )
+{
+    callback( "Material", static_cast<MemoryPoolBase*>( &appdata.global_store.material_pool ) );
+    callback( "ResourceSource", static_cast<MemoryPoolBase*>( &appdata.global_store.resource_sources_pool ) );
+
+    for( auto& pool_handle : appdata.global_store.resource_pool.pools )
+    {
+        if( pool_handle )
+            callback( appdata.metadata.type_infos[ pool_handle.type ]->name, pool_handle.pool );
+    }
+}
+
+void collect_pool_stats( Appdata& appdata, std::vector<NamedPoolStats>& out_stats )
+{
+    out_stats.clear();
+    for_each_pool( appdata, [&out_stats]( const char* name, MemoryPoolBase* pool ) {
+        out_stats.push_back( { name, pool->GetStats() } );
+    } );
+}
+
+void update_pool_stats( Appdata& appdata )
+{
+    auto& app_state = appdata.app_state;
+
+    f64 now = app_state.global_timer.Total();
+    f64 elapsed = now - app_state.pool_stats_sample_time;
+    if( elapsed < POOL_STATS_SAMPLE_PERIOD )
+        return;
+
+    for_each_pool( appdata, [elapsed]( const char*, MemoryPoolBase* pool ) {
+        pool->SampleRates( elapsed );
+    } );
+    app_state.pool_stats_sample_time = now;
+}
+
+static std::vector<NamedPoolStats> s_pool_stats;
+void draw_pool_stats( Appdata& appdata )
+{
+    collect_pool_stats( appdata, s_pool_stats );
+
+    ImGui::Columns( 8, "PoolStats" );
+    ImGui::Text( "Pool" );       ImGui::NextColumn();
+    ImGui::Text( "Live" );       ImGui::NextColumn();
+    ImGui::Text( "Peak" );       ImGui::NextColumn();
+    ImGui::Text( "Blobs" );      ImGui::NextColumn();
+    ImGui::Text( "Fill" );       ImGui::NextColumn();
+    ImGui::Text( "Frag." );      ImGui::NextColumn();
+    ImGui::Text( "Alloc/s" );    ImGui::NextColumn();
+    ImGui::Text( "Free/s" );     ImGui::NextColumn();
+    ImGui::Separator();
+
+    for( const auto& entry : s_pool_stats )
+    {
+        const auto& stats = entry.stats;
+        ImGui::Text( "%s", entry.name );                          ImGui::NextColumn();
+        ImGui::Text( "%u", stats.live_count );                    ImGui::NextColumn();
+        ImGui::Text( "%u", stats.peak_count );                    ImGui::NextColumn();
+        ImGui::Text( "%u", stats.blob_count );                    ImGui::NextColumn();
+        ImGui::Text( "%.1f%%", stats.fill_ratio * 100.0f );       ImGui::NextColumn();
+        ImGui::Text( "%.1f%%", stats.fragmentation * 100.0f );    ImGui::NextColumn();
+        ImGui::Text( "%.1f", stats.allocation_rate );             ImGui::NextColumn();
+        ImGui::Text( "%.1f", stats.free_rate );                   ImGui::NextColumn();
+    }
+    ImGui::Columns( 1 );
+
+#if !MEMORY_POOL_STATS
+    ImGui::TextDisabled( "Allocation counters are compiled out (MEMORY_POOL_STATS)." );
+#endif
+
+    if( ImGui::Button( "Dump pool stats" ) )
+        dump_pool_stats_csv( appdata, "pool_stats.csv" );
+}
+
+bool dump_pool_stats_csv( Appdata& appdata, const char* path )
+{
+    std::ofstream writer( path );
+    if( !writer.is_open() )
+    {
+        println( "Failed to open pool stats file %", path );
+        return false;
+    }
+
+    std::vector<NamedPoolStats> pool_stats;
+    collect_pool_stats( appdata, pool_stats );
+
+    writer << "pool,element_size,live_count,peak_count,blob_count,capacity,fill_ratio,fragmentation,allocation_count,free_count,allocation_rate,free_rate\n";
+    for( const auto& entry : pool_stats )
+    {
+        const auto& stats = entry.stats;
+        writer << entry.name << ','
+               << stats.element_size << ','
+               << stats.live_count << ','
+               << stats.peak_count << ','
+               << stats.blob_count << ','
+               << stats.capacity << ','
+               << stats.fill_ratio << ','
+               << stats.fragmentation << ','
+               << stats.allocation_count << ','
+               << stats.free_count << ','
+               << stats.allocation_rate << ','
+               << stats.free_rate << '\n';
+    }
+
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include "basic_types.h"
+#include "memory_pool.h"
+
+struct Appdata;
+
+struct NamedPoolStats
+{
+    const char*     name = nullptr;
+    MemoryPoolStats stats;
+};
+
+void collect_pool_stats( Appdata& appdata, std::vector<NamedPoolStats>& out_stats );
+
+// samples the allocation rates of every pool about once per second, call once per frame
+void update_pool_stats( Appdata& appdata );
+
+// ImGui content of the pool panel, to call inside a window
+void draw_pool_stats( Appdata& appdata );
+
+// headless dump of the same data, one line per pool
+bool dump_pool_stats_csv( Appdata& appdata, const char* path );
@@ -1,28 +1,56 @@
 #include "resource.h"
 #include "dll.h"
+#include "resource_pool.h"
+#include "file_watch.h"
+#include "resource_dependencies.h"
 
 #include <unordered_map>
+#include <algorithm>
 #include <string.h>
 
+static void remove_resource_name( Resource* resource )
+{
+    if( resource->name == INVALID_STRING_ID )
+        return;
+
+    NameIndex* names = get_resource_name_index( get_dll_appdata().global_store.resource_pool, resource->m_type_id );
+    if( names )
+        names->Remove( resource->name, resource );
+}
+
 void setup_resource( Resource* resource, const char* source_file, const char* name )
 {
-    resource->name = name;
+    // reloads setup the same resource again, drop the previous entry first
+    remove_resource_name( resource );
+
+    resource->name = intern_string( name );
     resource->loaded = false;
 
+    // names are interned, their id is a good enough hash
+    NameIndex* names = get_resource_name_index( get_dll_appdata().global_store.resource_pool, resource->m_type_id );
+    if( names )
+        names->Insert( resource->name, resource );
+
     add_resource_to_source( resource, source_file );
 }
 
 void clear_resource( Resource* resource )
 {
+    remove_resource_name( resource );
     remove_resource_from_source( resource );
+    remove_dependencies( resource );
 }
 
 ResourceSource* find_source( MemoryPool<ResourceSource>& pool, const char* source )
 {
-    for( auto s : pool )
-        if ( s->source == source )
-            return s;
-    return nullptr;
+    StringId source_id = find_string( source );
+    if( source_id == INVALID_STRING_ID )
+        return nullptr;
+
+    auto& names = get_dll_appdata().global_store.resource_sources_names;
+    return static_cast<ResourceSource*>( names.Find( source_id, [source_id]( void* value ) {
+        return static_cast<ResourceSource*>( value )->source == source_id;
+    } ) );
 }
 
 ResourceSource* create_source( MemoryPool<ResourceSource>& pool, const char* source )
@@ -30,7 +58,9 @@ ResourceSource* create_source( MemoryPool<ResourceSource>& pool, const char* sou
     auto& appdata = get_dll_appdata();
     
     auto resource_source = appdata.global_store.resource_sources_pool.Instantiate();
-    resource_source->source = source;
+    resource_source->source = intern_string( source );
+    appdata.global_store.resource_sources_names.Insert( resource_source->source, resource_source );
+    watch_file( source );
     return resource_source;
 }
 
@@ -45,6 +75,8 @@ ResourceSource* get_source( const char* source, bool add_if_needed )
 
 void add_resource_to_source( Resource* resource, const char* source_file )
 {
+    remove_resource_from_source( resource );
+
     if( source_file == nullptr )
     {
         resource->source = nullptr;
@@ -52,6 +84,7 @@ void add_resource_to_source( Resource* resource, const char* source_file )
     else
     {
         auto source = get_source( source_file, true );
+        source->resources.push_back( resource );
         resource->source = source;
     }
 }
@@ -60,6 +93,8 @@ void remove_resource_from_source( Resource* resource )
 {
     if( resource->source != nullptr )
     {
+        auto& resources = resource->source->resources;
+        resources.erase( std::remove( resources.begin(), resources.end(), resource ), resources.end() );
         resource->source = nullptr;
     }
 }
@@ -7,6 +7,8 @@
 #include "basic_types.h"
 #include "object.h"
 #include "memory_pool.h"
+#include "string_table.h"
+#include "load_telemetry.h"
 
 struct Resource;
 struct ResourceSource;
@@ -20,8 +22,15 @@ struct Resource : public Object
 
     // resource data
     bool loaded = false;
-    std::string name;
-
+    bool borrowed_from_archive = false; // data points into the read only mapping of the asset archive, never freed nor written
+    StringId name = INVALID_STRING_ID;
+
+    // residency, see resource_budget.h
+    u32  ref_count       = 0;     // unreferenced resources can be evicted
+    u32  last_used_frame = 0;
+    u64  cpu_size        = 0;     // bytes, kept up to date with set_resource_memory
+    u64  gpu_size        = 0;
+    bool evicted         = false; // reloaded from its source by use_resource
 };
 
 enum class ResourceSourceType
@@ -33,9 +42,12 @@ enum class ResourceSourceType
 
 struct ResourceSource
 {
-    std::string source;                 // source name
+    StringId source = INVALID_STRING_ID; // source name
     std::vector<std::string> errors;    // errors generated by the source
+    std::vector<Resource*> resources;   // resources loaded from the source, reloaded when it changes
+    LoadTelemetry telemetry;            // timings of its loads, see load_telemetry.h
 };
+template<> constexpr u32 get_pool_size<ResourceSource>() { return get_page_fitting_pool_size<ResourceSource>(); }
 
 void setup_resource( Resource* resource, const char* source_file, const char* name );
 void clear_resource( Resource* resource );
@@ -0,0 +1,104 @@
+#include "resource_budget.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "basics.h"
+#include "dll.h"
+
+static ResourceBudget& get_budget()
+{
+    return get_dll_appdata().global_store.resource_budget;
+}
+
+static u32 get_current_frame()
+{
+    return (u32)get_dll_appdata().app_state.global_frame_count;
+}
+
+void acquire_resource( Resource* resource )
+{
+    resource->ref_count++;
+    use_resource( resource );
+}
+
+void release_resource( Resource* resource )
+{
+    assert( resource->ref_count > 0, "Error: Released a resource that wasn't acquired." );
+    resource->ref_count--;
+}
+
+void use_resource( Resource* resource )
+{
+    resource->last_used_frame = get_current_frame();
+
+    if( resource->evicted && resource->source != nullptr )
+    {
+        resource->evicted = false;
+        reload_resource( resource );
+    }
+}
+
+void set_resource_memory( Resource* resource, u64 cpu_size, u64 gpu_size )
+{
+    auto& budget = get_budget();
+    budget.cpu_usage = budget.cpu_usage - resource->cpu_size + cpu_size;
+    budget.gpu_usage = budget.gpu_usage - resource->gpu_size + gpu_size;
+
+    resource->cpu_size = cpu_size;
+    resource->gpu_size = gpu_size;
+}
+
+void set_resource_budget( u64 cpu_budget, u64 gpu_budget )
+{
+    auto& budget = get_budget();
+    budget.cpu_budget = cpu_budget;
+    budget.gpu_budget = gpu_budget;
+}
+
+static u64 get_resource_memory( const Resource* resource, ResourceMemory memory )
+{
+    return memory == ResourceMemory::CPU ? resource->cpu_size : resource->gpu_size;
+}
+
+static void evict_to_budget( ResourceMemory memory )
+{
+    auto& budget = get_budget();
+    const u64& usage = memory == ResourceMemory::CPU ? budget.cpu_usage : budget.gpu_usage;
+    u64 limit        = memory == ResourceMemory::CPU ? budget.cpu_budget : budget.gpu_budget;
+    if( usage <= limit )
+        return;
+
+    // only sourced resources can come back, so they are the only ones looked at
+    // @Note: Resources used during the last frame are kept, evicting them would reload them right away.
+    u32 current_frame = get_current_frame();
+    static std::vector<Resource*> candidates;
+    candidates.clear();
+    for( auto source : get_dll_appdata().global_store.resource_sources_pool )
+    {
+        for( auto resource : source->resources )
+        {
+            if( resource->ref_count == 0 && get_resource_memory( resource, memory ) > 0 && resource->last_used_frame + 1 < current_frame )
+                candidates.push_back( resource );
+        }
+    }
+
+    std::sort( candidates.begin(), candidates.end(), []( const Resource* a, const Resource* b ) {
+        return a->last_used_frame < b->last_used_frame;
+    } );
+
+    for( auto resource : candidates )
+    {
+        if( usage <= limit )
+            break;
+
+        if( evict_resource( resource, memory ) )
+            budget.eviction_count++;
+    }
+}
+
+void enforce_resource_budget()
+{
+    evict_to_budget( ResourceMemory::CPU );
+    evict_to_budget( ResourceMemory::GPU );
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "basic_types.h"
+#include "resource_pool.h"
+
+#define DEFAULT_RESOURCE_CPU_BUDGET ( 512ull * 1024 * 1024 )
+#define DEFAULT_RESOURCE_GPU_BUDGET ( 1024ull * 1024 * 1024 )
+
+// Memory used by the resources against the budget, lives in the GlobalStore.
+// When a budget is exceeded the least recently used resources with no reference are
+// evicted, the ones that lost their data get reloaded from their source on next use.
+// @Note: Only resources with a source are evicted, the others couldn't come back.
+struct ResourceBudget
+{
+    u64 cpu_budget = DEFAULT_RESOURCE_CPU_BUDGET;
+    u64 gpu_budget = DEFAULT_RESOURCE_GPU_BUDGET;
+
+    u64 cpu_usage = 0;
+    u64 gpu_usage = 0;
+
+    u32 eviction_count = 0;
+};
+
+struct Resource;
+
+// referenced resources are never evicted
+void acquire_resource( Resource* resource );
+void release_resource( Resource* resource );
+
+// marks the resource as used this frame, starts its reload if it was evicted
+void use_resource( Resource* resource );
+
+// called by the loaders and evictors whenever the data of a resource changes
+void set_resource_memory( Resource* resource, u64 cpu_size, u64 gpu_size );
+
+void set_resource_budget( u64 cpu_budget, u64 gpu_budget );
+
+// main thread, once per frame: evicts until the usage fits in the budget again
+void enforce_resource_budget();
@@ -0,0 +1,129 @@
+#include "resource_dependencies.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "basics.h"
+#include "dll.h"
+
+static DependencyHandler s_handlers[ (u32)DependentKind::Count ] = {};
+
+DependencyHandlerRegistration::DependencyHandlerRegistration( DependentKind kind, DependencyHandler handler )
+{
+    s_handlers[ (u32)kind ] = handler;
+}
+
+static ResourceDependencies& get_dependencies()
+{
+    return get_dll_appdata().global_store.resource_dependencies;
+}
+
+template<typename T, typename F>
+static void erase_if( std::vector<T>& values, F predicate )
+{
+    values.erase( std::remove_if( values.begin(), values.end(), predicate ), values.end() );
+}
+
+void add_dependency( void* dependent, DependentKind kind, const void* dependency )
+{
+    auto& graph = get_dependencies();
+
+    auto& uses = graph.dependencies[ dependent ];
+    if( std::find( uses.begin(), uses.end(), dependency ) != uses.end() )
+        return;
+
+    uses.push_back( dependency );
+    graph.dependents[ dependency ].push_back( { dependent, kind } );
+}
+
+void remove_dependency( const void* dependent, const void* dependency )
+{
+    auto& graph = get_dependencies();
+
+    auto uses = graph.dependencies.find( dependent );
+    if( uses != graph.dependencies.end() )
+    {
+        erase_if( uses->second, [dependency]( const void* value ) { return value == dependency; } );
+        if( uses->second.empty() )
+            graph.dependencies.erase( uses );
+    }
+
+    auto users = graph.dependents.find( dependency );
+    if( users != graph.dependents.end() )
+    {
+        erase_if( users->second, [dependent]( const DependencyLink& link ) { return link.dependent == dependent; } );
+        if( users->second.empty() )
+            graph.dependents.erase( users );
+    }
+}
+
+void remove_dependencies( const void* object )
+{
+    auto& graph = get_dependencies();
+
+    auto uses = graph.dependencies.find( object );
+    if( uses != graph.dependencies.end() )
+    {
+        std::vector<const void*> dependencies;
+        dependencies.swap( uses->second );
+        for( auto dependency : dependencies )
+            remove_dependency( object, dependency );
+        graph.dependencies.erase( object );
+    }
+
+    auto users = graph.dependents.find( object );
+    if( users != graph.dependents.end() )
+    {
+        std::vector<DependencyLink> dependents;
+        dependents.swap( users->second );
+        for( auto& link : dependents )
+            remove_dependency( link.dependent, object );
+        graph.dependents.erase( object );
+    }
+
+    erase_if( graph.invalidated, [object]( const void* value ) { return value == object; } );
+}
+
+void invalidate_dependents( const void* dependency )
+{
+    auto& graph = get_dependencies();
+    if( graph.dependents.find( dependency ) != graph.dependents.end() )
+        graph.invalidated.push_back( dependency );
+}
+
+void process_dependency_invalidations()
+{
+    auto& graph = get_dependencies();
+    if( graph.invalidated.empty() )
+        return;
+
+    // each dependency is resolved once per frame, whatever the number of reloads behind it,
+    // the visited set also stops cycles
+    std::unordered_set<const void*> visited;
+    std::vector<const void*> pending;
+    pending.swap( graph.invalidated );
+
+    while( !pending.empty() )
+    {
+        const void* dependency = pending.back();
+        pending.pop_back();
+        if( !visited.insert( dependency ).second )
+            continue;
+
+        auto users = graph.dependents.find( dependency );
+        if( users == graph.dependents.end() )
+            continue;
+
+        // @Note: Copied, a handler may change the links of the dependency.
+        std::vector<DependencyLink> links = users->second;
+        for( auto& link : links )
+        {
+            DependencyHandler handler = s_handlers[ (u32)link.kind ];
+            if( handler == nullptr )
+                continue;
+
+            if( handler( link.dependent, dependency ) )
+                pending.push_back( link.dependent );
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "basic_types.h"
+
+// Graph of what uses what: materials use a shader and textures, later anything with a
+// stable address can take part. When a dependency changes (a reload, a new GL name) only
+// its direct dependents are re-resolved, through the handler of their kind. A dependent
+// that changed in turn is propagated to its own dependents.
+// The links live in the GlobalStore and only hold data, the handlers are registered by
+// the dll like the reloaders so they survive dll reloads.
+
+enum class DependentKind : u32
+{
+    MATERIAL,
+
+    Count,
+};
+
+struct DependencyLink
+{
+    void*         dependent = nullptr;
+    DependentKind kind      = DependentKind::MATERIAL;
+};
+
+struct ResourceDependencies
+{
+    std::unordered_map<const void*, std::vector<DependencyLink>> dependents;   // dependency to what uses it
+    std::unordered_map<const void*, std::vector<const void*>>    dependencies; // dependent to what it uses
+    std::vector<const void*> invalidated; // since the last process_dependency_invalidations
+};
+
+// Re-resolves what dependent took from dependency, returns true if the dependent changed
+// so its own dependents are invalidated too.
+typedef bool (*DependencyHandler)( void* dependent, const void* dependency );
+
+#define REGISTER_DEPENDENCY_HANDLER( Kind, Handler ) \
+    static DependencyHandlerRegistration s_##Kind##_dependency_handler_registration( DependentKind::Kind, Handler )
+
+struct DependencyHandlerRegistration
+{
+    DependencyHandlerRegistration( DependentKind kind, DependencyHandler handler );
+};
+
+void add_dependency( void* dependent, DependentKind kind, const void* dependency ); // linking twice is fine
+void remove_dependency( const void* dependent, const void* dependency );
+void remove_dependencies( const void* object ); // both ways, before it is destroyed
+
+// queued, a dependency invalidated several times before the next frame is resolved once
+void invalidate_dependents( const void* dependency );
+
+// main thread, once per frame after the loads: runs the handlers of the invalidated dependencies
+void process_dependency_invalidations();
@@ -0,0 +1,193 @@
+#include "resource_file_cache.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "basics.h"
+#include "content_hash.h"
+
+static std::atomic<u32> s_hits   { 0 };
+static std::atomic<u32> s_misses { 0 };
+static std::atomic<u32> s_writes { 0 };
+static std::atomic<u32> s_temporary_count { 0 };
+static std::atomic<bool> s_enabled { true };
+
+static void make_directory( const char* path )
+{
+#ifdef _WIN32
+    _mkdir( path );
+#else
+    mkdir( path, 0755 );
+#endif
+}
+
+static void get_entry_path( const char* path, ResourceFileMode mode, char* buffer, u32 buffer_length )
+{
+    u64 key = hash_content( path, strlen( path ), (u64)mode ^ ( (u64)RESOURCE_FILE_CACHE_VERSION << 56 ) );
+    snprintf( buffer, buffer_length, RESOURCE_FILE_CACHE_DIRECTORY "%016llx.bin", (unsigned long long)key );
+}
+
+static u64 get_blocks_offset( u64 path_length )
+{
+    return ( sizeof(ResourceFileCacheHeader) + path_length + 7 ) & ~(u64)7;
+}
+
+// every offset is checked, a truncated or foreign entry is a miss and not a crash
+static bool is_valid_entry( const MappedFile& entry, const char* path, ResourceFileMode mode, u64 source_size, u64 source_write_time )
+{
+    if( entry.size < sizeof(ResourceFileCacheHeader) )
+        return false;
+
+    auto header = reinterpret_cast<const ResourceFileCacheHeader*>( entry.data );
+    if( header->magic != RESOURCE_FILE_CACHE_MAGIC || header->version != RESOURCE_FILE_CACHE_VERSION
+        || header->mode != (u32)mode || header->source_size != source_size || header->source_write_time != source_write_time )
+        return false;
+
+    u64 path_length = strlen( path );
+    if( header->path_length != path_length || sizeof(ResourceFileCacheHeader) + path_length > entry.size
+        || memcmp( entry.data + sizeof(ResourceFileCacheHeader), path, (size_t)path_length ) != 0 )
+        return false;
+
+    u64 blocks_end = (u64)header->blocks_offset + (u64)header->block_count * sizeof(ResourceFileCacheBlock);
+    if( header->blocks_offset != get_blocks_offset( path_length ) || blocks_end > header->text_offset
+        || header->text_offset > entry.size || header->text_size != entry.size - header->text_offset )
+        return false;
+
+    auto blocks = reinterpret_cast<const ResourceFileCacheBlock*>( entry.data + header->blocks_offset );
+    for( u32 i = 0; i < header->block_count; ++i )
+    {
+        if( (u64)blocks[i].name_offset + blocks[i].name_length > header->text_size
+            || (u64)blocks[i].content_offset + blocks[i].content_length > header->text_size )
+            return false;
+    }
+
+    return true;
+}
+
+bool open_resource_file_cache( const char* path, ResourceFileMode mode, u64 source_size, u64 source_write_time, ResourceFile& file )
+{
+    assert( file.mapping.data == nullptr, "The resource file already owns a mapping." );
+    if( !s_enabled.load( std::memory_order_relaxed ) )
+        return false;
+
+    char entry_path[256];
+    get_entry_path( path, mode, entry_path, sizeof(entry_path) );
+
+    MappedFile entry;
+    if( !map_file( entry_path, entry ) || !is_valid_entry( entry, path, mode, source_size, source_write_time ) )
+    {
+        unmap_file( entry );
+        s_misses.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+
+    auto header = reinterpret_cast<const ResourceFileCacheHeader*>( entry.data );
+    auto blocks = reinterpret_cast<const ResourceFileCacheBlock*>( entry.data + header->blocks_offset );
+    auto text   = reinterpret_cast<const char*>( entry.data + header->text_offset );
+
+    file.blocks.clear();
+    file.blocks.reserve( header->block_count );
+    for( u32 i = 0; i < header->block_count; ++i )
+    {
+        file.blocks.push_back( {
+            { text + blocks[i].name_offset, blocks[i].name_length },
+            { text + blocks[i].content_offset, blocks[i].content_length },
+            blocks[i].offset,
+            blocks[i].hash,
+            true
+        } );
+    }
+    file.mapping = entry;
+
+    s_hits.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+}
+
+bool write_resource_file_cache( const ResourceFile& file, ResourceFileMode mode, u64 source_size, u64 source_write_time, const char* text, u64 text_size )
+{
+    if( !s_enabled.load( std::memory_order_relaxed ) )
+        return false;
+
+    static std::once_flag directory_flag;
+    std::call_once( directory_flag, [] {
+        make_directory( "cache" );
+        make_directory( RESOURCE_FILE_CACHE_DIRECTORY );
+    } );
+
+    ResourceFileCacheHeader header;
+    header.source_size       = source_size;
+    header.source_write_time = source_write_time;
+    header.mode              = (u32)mode;
+    header.path_length       = (u32)file.path.size();
+    header.block_count       = (u32)file.blocks.size();
+    header.blocks_offset     = (u32)get_blocks_offset( file.path.size() );
+    header.text_offset       = header.blocks_offset + file.blocks.size() * sizeof(ResourceFileCacheBlock);
+    header.text_size         = text_size;
+
+    std::vector<ResourceFileCacheBlock> blocks( file.blocks.size() );
+    for( size_t i = 0; i < file.blocks.size(); ++i )
+    {
+        auto& block = file.blocks[i];
+        assert( block.name.data() >= text && block.content.end() <= text + text_size, "The blocks must point into the cached text." );
+        blocks[i].name_offset    = (u32)( block.name.data() - text );
+        blocks[i].name_length    = block.name.size();
+        blocks[i].content_offset = (u32)( block.content.data() - text );
+        blocks[i].content_length = block.content.size();
+        blocks[i].hash           = block.hash;
+        blocks[i].offset         = block.offset;
+    }
+
+    char path[256];
+    char temporary_path[256];
+    get_entry_path( file.path.c_str(), mode, path, sizeof(path) );
+    snprintf( temporary_path, sizeof(temporary_path), "%s.%u.tmp", path, s_temporary_count.fetch_add( 1, std::memory_order_relaxed ) );
+
+    FILE* entry = fopen( temporary_path, "wb" );
+    if( entry == nullptr )
+        return false;
+
+    const u8 padding[8] = {};
+    size_t padding_size = header.blocks_offset - sizeof(header) - file.path.size();
+    bool written = fwrite( &header, sizeof(header), 1, entry ) == 1
+                && fwrite( file.path.data(), file.path.size(), 1, entry ) == 1
+                && ( padding_size == 0 || fwrite( padding, padding_size, 1, entry ) == 1 )
+                && ( blocks.empty() || fwrite( blocks.data(), blocks.size() * sizeof(ResourceFileCacheBlock), 1, entry ) == 1 )
+                && ( text_size == 0 || fwrite( text, (size_t)text_size, 1, entry ) == 1 );
+    written = ( fclose( entry ) == 0 ) && written;
+
+    // @Platform: rename doesn't replace an existing file on Windows
+#ifdef _WIN32
+    if( written )
+        remove( path );
+#endif
+    if( !written || rename( temporary_path, path ) != 0 )
+    {
+        remove( temporary_path );
+        return false;
+    }
+
+    s_writes.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+}
+
+void set_resource_file_cache_enabled( bool enabled )
+{
+    s_enabled.store( enabled, std::memory_order_relaxed );
+}
+
+ResourceFileCacheStats get_resource_file_cache_stats()
+{
+    ResourceFileCacheStats stats;
+    stats.hits   = s_hits.load( std::memory_order_relaxed );
+    stats.misses = s_misses.load( std::memory_order_relaxed );
+    stats.writes = s_writes.load( std::memory_order_relaxed );
+    return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "basic_types.h"
+#include "file_parser.h"
+
+#define RESOURCE_FILE_CACHE_DIRECTORY "cache/parsed/"
+#define RESOURCE_FILE_CACHE_MAGIC     0x43524c48 // "HLRC"
+#define RESOURCE_FILE_CACHE_VERSION   1          // bump when the entry layout or the parsing rules change
+
+// On disk cache of parsed resource files, one entry per source path and mode, checked against
+// the size and write time of the source: a hit is one mapping and the source is never opened.
+// Entry layout: ResourceFileCacheHeader | path | ResourceFileCacheBlock[block_count] | text.
+// The blocks are offsets into the text, which is the source as it was parsed.
+// @Note: An entry is replaced when its source changes, clearing the directory is always safe.
+
+struct ResourceFileCacheHeader
+{
+    u32 magic             = RESOURCE_FILE_CACHE_MAGIC;
+    u32 version           = RESOURCE_FILE_CACHE_VERSION;
+    u64 source_size       = 0;
+    u64 source_write_time = 0;
+    u32 mode              = 0; // ResourceFileMode
+    u32 path_length       = 0;
+    u32 block_count       = 0;
+    u32 blocks_offset     = 0; // from the start of the entry, aligned on 8
+    u64 text_offset       = 0;
+    u64 text_size         = 0;
+};
+
+struct ResourceFileCacheBlock
+{
+    u32 name_offset    = 0; // in the text
+    u32 name_length    = 0;
+    u32 content_offset = 0;
+    u32 content_length = 0;
+    u64 hash           = 0;
+    u32 offset         = 0; // RFBlock::offset
+    u32 padding        = 0;
+};
+
+struct ResourceFileCacheStats
+{
+    u32 hits   = 0;
+    u32 misses = 0;
+    u32 writes = 0;
+};
+
+// on a hit the blocks of file point into the entry, which the file then owns
+bool open_resource_file_cache( const char* path, ResourceFileMode mode, u64 source_size, u64 source_write_time, ResourceFile& file );
+// text is what the blocks of file point into, written to a temporary file first so readers never see half an entry
+bool write_resource_file_cache( const ResourceFile& file, ResourceFileMode mode, u64 source_size, u64 source_write_time, const char* text, u64 text_size );
+
+// on by default, the parse benchmarks turn it off to time the parsing itself
+void set_resource_file_cache_enabled( bool enabled );
+
+ResourceFileCacheStats get_resource_file_cache_stats(); // since the dll was loaded
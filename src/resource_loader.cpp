@@ -0,0 +1,131 @@
+#include "resource_loader.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#include "basics.h"
+
+namespace
+{
+    struct ResourceLoader
+    {
+        std::vector<std::thread> workers;
+
+        std::mutex              mutex;
+        std::condition_variable job_ready;
+        std::deque<ResourceLoadJob> queued_jobs;
+        std::deque<ResourceLoadJob> decoded_jobs;
+        u32  decoding_count = 0;
+        bool stopping       = false;
+    };
+}
+
+// the workers run dll code, so the loader lives in the dll and is rebuilt on each reload
+static ResourceLoader s_loader;
+
+static void worker_loop()
+{
+    while( true )
+    {
+        ResourceLoadJob job;
+        {
+            std::unique_lock<std::mutex> lock( s_loader.mutex );
+            s_loader.job_ready.wait( lock, [] { return s_loader.stopping || !s_loader.queued_jobs.empty(); } );
+
+            // the queue is drained before stopping so no load is lost on a reload
+            if( s_loader.queued_jobs.empty() )
+                return;
+
+            job = std::move( s_loader.queued_jobs.front() );
+            s_loader.queued_jobs.pop_front();
+            s_loader.decoding_count++;
+        }
+
+        job.decode( job );
+
+        {
+            std::lock_guard<std::mutex> lock( s_loader.mutex );
+            s_loader.decoded_jobs.push_back( std::move( job ) );
+            s_loader.decoding_count--;
+        }
+    }
+}
+
+void init_resource_loader( u32 worker_count )
+{
+    assert( s_loader.workers.empty(), "Resource loader is already running." );
+
+    if( worker_count == 0 )
+    {
+        u32 core_count = std::thread::hardware_concurrency();
+        worker_count = core_count > 1 ? core_count - 1 : 1;
+    }
+
+    s_loader.stopping = false;
+    for( u32 i = 0; i < worker_count; ++i )
+        s_loader.workers.emplace_back( worker_loop );
+}
+
+void shutdown_resource_loader()
+{
+    {
+        std::lock_guard<std::mutex> lock( s_loader.mutex );
+        s_loader.stopping = true;
+    }
+    s_loader.job_ready.notify_all();
+
+    for( auto& worker : s_loader.workers )
+        worker.join();
+    s_loader.workers.clear();
+
+    finalize_resource_loads( max_value<u32>() );
+}
+
+void queue_resource_load( const ResourceLoadJob& job )
+{
+    assert( job.decode && job.finalize, "Resource load job without decode or finalize." );
+
+    if( s_loader.workers.empty() )
+    {
+        // no worker yet, load in place
+        ResourceLoadJob sync_job = job;
+        sync_job.decode( sync_job );
+        sync_job.finalize( sync_job );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( s_loader.mutex );
+        s_loader.queued_jobs.push_back( job );
+    }
+    s_loader.job_ready.notify_one();
+}
+
+u32 finalize_resource_loads( u32 max_count )
+{
+    u32 finalized_count = 0;
+    while( finalized_count < max_count )
+    {
+        ResourceLoadJob job;
+        {
+            std::lock_guard<std::mutex> lock( s_loader.mutex );
+            if( s_loader.decoded_jobs.empty() )
+                break;
+            job = std::move( s_loader.decoded_jobs.front() );
+            s_loader.decoded_jobs.pop_front();
+        }
+
+        job.finalize( job );
+        finalized_count++;
+    }
+    return finalized_count;
+}
+
+u32 get_pending_resource_load_count()
+{
+    std::lock_guard<std::mutex> lock( s_loader.mutex );
+    return (u32)( s_loader.queued_jobs.size() + s_loader.decoded_jobs.size() ) + s_loader.decoding_count;
+}
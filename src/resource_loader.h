@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include "basic_types.h"
+#include "resource_pool.h"
+
+#define RESOURCE_FINALIZE_PER_FRAME 4 // loads finished on the main thread each frame
+
+// A resource load split in two: decode runs on a worker and does the file io and
+// the decoding, finalize runs on the main thread and does the GL work. decode must not
+// touch the pools or GL, finalize must release decoded even if the resource is gone.
+struct ResourceLoadJob
+{
+    ResourceHandle resource;
+    std::string    path;
+    void*          decoded = nullptr; // produced by decode, nullptr if it failed
+
+    void (*decode)( ResourceLoadJob& job )   = nullptr;
+    void (*finalize)( ResourceLoadJob& job ) = nullptr;
+};
+
+// worker_count 0 uses one worker per core, the main thread excluded
+void init_resource_loader( u32 worker_count = 0 );
+// waits for the queued loads and finalizes them, call before the dll is unloaded
+void shutdown_resource_loader();
+
+void queue_resource_load( const ResourceLoadJob& job );
+// finalizes at most max_count decoded loads, returns how many were finalized
+u32  finalize_resource_loads( u32 max_count );
+u32  get_pending_resource_load_count();
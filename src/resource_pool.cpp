@@ -3,20 +3,95 @@
 #include "type_db.h"
 #include "dll.h"
 
-static MemoryPoolBase* create_pool( TypeId type )
+static std::vector<ResourcePoolFactory>& get_pool_factories()
 {
-    switch( (LocalTypeId)type )
+    static std::vector<ResourcePoolFactory> factories;
+    return factories;
+}
+
+ResourcePoolRegistration::ResourcePoolRegistration( TypeId type, ResourcePoolFactory factory )
+{
+    auto& factories = get_pool_factories();
+    if( factories.size() <= type )
+        factories.resize( (size_t)type + 1, nullptr );
+    factories[type] = factory;
+}
+
+static std::vector<ResourceReloader>& get_reloaders()
+{
+    static std::vector<ResourceReloader> reloaders;
+    return reloaders;
+}
+
+ResourceReloaderRegistration::ResourceReloaderRegistration( TypeId type, ResourceReloader reloader )
+{
+    auto& reloaders = get_reloaders();
+    if( reloaders.size() <= type )
+        reloaders.resize( (size_t)type + 1, nullptr );
+    reloaders[type] = reloader;
+}
+
+bool reload_resource( Resource* resource )
+{
+    auto& reloaders = get_reloaders();
+    TypeId type = resource->m_type_id;
+    if( type >= reloaders.size() || reloaders[type] == nullptr )
+        return false;
+
+    reloaders[type]( resource );
+    return true;
+}
+
+static std::vector<ResourceEvictor>& get_evictors()
+{
+    static std::vector<ResourceEvictor> evictors;
+    return evictors;
+}
+
+ResourceEvictorRegistration::ResourceEvictorRegistration( TypeId type, ResourceEvictor evictor )
+{
+    auto& evictors = get_evictors();
+    if( evictors.size() <= type )
+        evictors.resize( (size_t)type + 1, nullptr );
+    evictors[type] = evictor;
+}
+
+bool evict_resource( Resource* resource, ResourceMemory memory )
+{
+    auto& evictors = get_evictors();
+    TypeId type = resource->m_type_id;
+    if( type >= evictors.size() || evictors[type] == nullptr )
+        return false;
+
+    evictors[type]( resource, memory );
+    return true;
+}
+
+static bool is_resource_type( const TypeInfo* type )
+{
+    if( type == nullptr || type->type != TypeInfoType::Struct )
+        return false;
+
+    // Resource itself is only a base
+    for( const TypeInfo* parent = type->struct_info.parent; parent; parent = parent->struct_info.parent )
     {
-        case LocalTypeId::Shader_id:
-            return new MemoryPool<Shader>();
-        case LocalTypeId::MeshDef_id:
-            return new MemoryPool<MeshDef>();
-        case LocalTypeId::Texture_id:
-            return new MemoryPool<Texture>();
+        if( strcmp( parent->name, "Resource" ) == 0 )
+            return true;
     }
+    return false;
+}
 
-    assert_fmt( false, "Can't create pool from % type_id", type );
-    return nullptr;
+void init_resource_pools( ResourcePool& resource_pool, const Metadata& metadata )
+{
+    // on reloads only the new types get a pool
+    if( resource_pool.pools.size() < metadata.type_infos.size() )
+        resource_pool.pools.resize( metadata.type_infos.size() );
+
+    for( const TypeInfo* type : metadata.type_infos )
+    {
+        if( is_resource_type( type ) && !resource_pool.pools[type->type_id] )
+            init_resource_pool( resource_pool, type->type_id );
+    }
 }
 
 void init_resource_pool( ResourcePool& resource_pool, TypeId type )
@@ -24,38 +99,41 @@ void init_resource_pool( ResourcePool& resource_pool, TypeId type )
     const Metadata& metadata = get_dll_appdata().metadata;
 
     const TypeInfo* resource_type = metadata.type_infos[type];
+    assert_fmt( is_resource_type( resource_type ), "Type % is not a Resource.", resource_type->name );
 
-    // check that type inherit Resource
-    const TypeInfo* resource_check = resource_type;
-    if( resource_check->type != TypeInfoType::Struct )
-        resource_check = nullptr;
-    while( resource_check && strcmp( resource_check->name, "Resource" ) != 0 )
-        resource_check = resource_check->struct_info.parent;
-    assert_fmt( resource_check, "Type % is not a Resource.", resource_type->name );
+    auto& factories = get_pool_factories();
+    if( type >= factories.size() || factories[type] == nullptr )
+    {
+        println( "WARNING: No pool registered for the resource type %, add REGISTER_RESOURCE_POOL( % ).", resource_type->name, resource_type->name );
+        return;
+    }
 
-    int pool_index = 0;
-    while( pool_index < MAX_RPOOL_COUNT && resource_pool.pools[pool_index] ) 
-        pool_index++;
+    MemoryPoolConfig config;
+    config.reserve_size = RESOURCE_POOL_RESERVE_SIZE;
 
-    resource_pool.pools[pool_index] = { type, create_pool( type ) };
+    if( resource_pool.pools.size() <= type )
+        resource_pool.pools.resize( (size_t)type + 1 );
+    resource_pool.pools[type] = { type, factories[type]( config ), new NameIndex() };
 }
 
-MemoryPoolBase* get_resource_pool( ResourcePool& resource_pool, TypeId type )
+Resource* find_resource( ResourcePool& resource_pool, TypeId type, const char* name )
 {
-    uint pool_index = 0;
-    while( pool_index < MAX_RPOOL_COUNT && resource_pool.pools[pool_index] && resource_pool.pools[pool_index].type != type ) 
-        pool_index++;
-
-    if( pool_index < MAX_RPOOL_COUNT )
-        return resource_pool.pools[pool_index].pool;
-    else
+    NameIndex* names = get_resource_name_index( resource_pool, type );
+    StringId name_id = find_string( name );
+    if( names == nullptr || name_id == INVALID_STRING_ID )
         return nullptr;
+
+    return static_cast<Resource*>( names->Find( name_id, [name_id]( void* value ) {
+        return static_cast<Resource*>( value )->name == name_id;
+    } ) );
 }
 
 Resource* get_resource( ResourcePool& resource_pool, ResourceHandle handle )
 {
     auto pool = get_resource_pool( resource_pool, handle.type );
-    return static_cast<Resource*>( pool->GetRaw( handle.id ) );
+    if( pool == nullptr )
+        return nullptr;
+    return static_cast<Resource*>( pool->TryGetRaw( handle.id ) );
 }
 
 ResourcePoolHandle::operator bool()
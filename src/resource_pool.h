@@ -1,37 +1,102 @@
 #pragma once
 
+#include <vector>
+
 #include "basics.h"
 #include "types.h"
 #include "memory_pool.h"
+#include "name_index.h"
 
-#define MAX_RPOOL_COUNT 8
+#define RESOURCE_POOL_RESERVE_SIZE ( 256ull * 1024 * 1024 ) // address space only, committed on demand
 
 struct Resource;
 struct ResourceHandle;
-typedef u32 ResourceId;
+typedef PoolHandle ResourceId;
 
 struct ResourceHandle
 {
-    TypeId type;
-    ResourceId id;
+    TypeId type   = INVALID_TYPE_ID;
+    ResourceId id = INVALID_POOL_HANDLE;
 };
 
 struct ResourcePoolHandle
 {
     TypeId type          = INVALID_TYPE_ID;
     MemoryPoolBase* pool = nullptr;
+    NameIndex* names     = nullptr; // resources of the pool by interned name, see setup_resource
 
     operator bool();
 };
 
+// Pools indexed by TypeId, sized from the metadata type count.
 struct ResourcePool
 {
-    ResourcePoolHandle pools[MAX_RPOOL_COUNT] = {};
+    std::vector<ResourcePoolHandle> pools = {};
+};
+
+typedef MemoryPoolBase* (*ResourcePoolFactory)( const MemoryPoolConfig& config );
+
+// Declares the pool type of a Resource, once in the .cpp of the type.
+// Factories are registered when the dll loads, init_resource_pools then gives a pool to
+// every type the metadata reports as Resource derived.
+#define REGISTER_RESOURCE_POOL( Type ) \
+    static ResourcePoolRegistration s_##Type##_pool_registration( type_id<Type>(), \
+        []( const MemoryPoolConfig& config ) -> MemoryPoolBase* { return new MemoryPool<Type>( config ); } )
+
+struct ResourcePoolRegistration
+{
+    ResourcePoolRegistration( TypeId type, ResourcePoolFactory factory );
+};
+
+// Reloads a resource from its source, used when the source file changes.
+typedef void (*ResourceReloader)( Resource* resource );
+
+#define REGISTER_RESOURCE_RELOADER( Type, Reloader ) \
+    static ResourceReloaderRegistration s_##Type##_reloader_registration( type_id<Type>(), Reloader )
+
+struct ResourceReloaderRegistration
+{
+    ResourceReloaderRegistration( TypeId type, ResourceReloader reloader );
+};
+
+bool reload_resource( Resource* resource ); // false if the type has no reloader
+
+enum class ResourceMemory
+{
+    CPU,
+    GPU,
+};
+
+// Releases the CPU or GPU side of a resource to stay in the budget, see resource_budget.h.
+// The evictor updates the sizes with set_resource_memory and sets evicted if the resource
+// can't be used anymore until it is reloaded.
+typedef void (*ResourceEvictor)( Resource* resource, ResourceMemory memory );
+
+#define REGISTER_RESOURCE_EVICTOR( Type, Evictor ) \
+    static ResourceEvictorRegistration s_##Type##_evictor_registration( type_id<Type>(), Evictor )
+
+struct ResourceEvictorRegistration
+{
+    ResourceEvictorRegistration( TypeId type, ResourceEvictor evictor );
 };
 
+bool evict_resource( Resource* resource, ResourceMemory memory ); // false if the type has no evictor
+
+struct Metadata;
+void init_resource_pools( ResourcePool& resource_pool, const Metadata& metadata );
 void init_resource_pool( ResourcePool& resource_pool, TypeId type );
-MemoryPoolBase* get_resource_pool( ResourcePool& resource_pool, TypeId type );
-Resource* get_resource( ResourceHandle handle );
+Resource* get_resource( ResourcePool& resource_pool, ResourceHandle handle ); // nullptr if the handle is stale
+Resource* find_resource( ResourcePool& resource_pool, TypeId type, const char* name );
+
+inline MemoryPoolBase* get_resource_pool( ResourcePool& resource_pool, TypeId type )
+{
+    return type < resource_pool.pools.size() ? resource_pool.pools[type].pool : nullptr;
+}
+
+inline NameIndex* get_resource_name_index( ResourcePool& resource_pool, TypeId type )
+{
+    return type < resource_pool.pools.size() ? resource_pool.pools[type].names : nullptr;
+}
 
 template<typename T>
 void init_resource_pool( ResourcePool& resource_pool )
@@ -50,4 +115,16 @@ T* get_resource( ResourcePool& resource_pool, ResourceHandle handle )
 {
     assert( type_id<T>() == handle.type, "Handle and requested type don't match." );
     return static_cast<T*>( get_resource( resource_pool, handle ) );
-}
\ No newline at end of file
+}
+
+template<typename T>
+T* find_resource( ResourcePool& resource_pool, const char* name )
+{
+    return static_cast<T*>( find_resource( resource_pool, type_id<T>(), name ) );
+}
+
+template<typename T>
+ResourceHandle get_resource_handle( ResourcePool& resource_pool, const T* resource )
+{
+    return { type_id<T>(), get_resource_pool<T>( resource_pool ).HandleOf( resource ) };
+}
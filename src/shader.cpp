@@ -10,6 +10,13 @@
 #include <vector>
 
 #include "dll.h"
+#include "type_db.h"
+#include "texture.h"
+#include "resource_dependencies.h"
+#include "load_telemetry.h"
+#include "resource_budget.h"
+
+REGISTER_RESOURCE_POOL( Shader );
 
 static ShaderParamType s_ShaderParamUsageToTypeTable[] = {
     ShaderParamType::UNKNOWN,
@@ -46,6 +53,7 @@ const char* to_string( ShaderParamType type )
 }
 
 static const char* s_ShaderParamUsageStringTable[] = {
+    "custom",
     "world",
     "view",
     "projection",
@@ -53,7 +61,6 @@ static const char* s_ShaderParamUsageStringTable[] = {
     "color",
     "normal",
     "uv",
-    "custom",
 };
 static_assert( ARRAY_SIZE( s_ShaderParamUsageStringTable ) == (int)ShaderParamUsage::Count, "Update s_ShaderParamUsageStringTable if you update ShaderParamUsage enum." );
 
@@ -79,46 +86,77 @@ const char* to_string( ShaderParamUsage usage )
     return s_ShaderParamUsageStringTable[(uint)usage];
 }
 
-static ShaderParam make_shader_param( const char* name, uint location,
-                               const char* type, const char* usage )
+template<typename Enum, uint Count>
+static bool find_in_string_table( const char* (&table)[Count], const RFString& text, Enum& out_value )
 {
-    ShaderParam param;
-
-    param.name = name;
-    param.location = location;
-
-    for(uint i=0; i<ARRAY_SIZE(s_ShaderParamTypeStringTable); ++i)
+    for(uint i=0; i<Count; ++i)
     {
-        auto type_str = s_ShaderParamTypeStringTable[i];
-        if( strcmp(type_str, type) == 0 )
+        if( text == table[i] )
         {
-            param.type = (ShaderParamType)i;
-            break;
+            out_value = (Enum)i;
+            return true;
         }
     }
+    return false;
+}
 
-    if( !is_eof_or_nil(usage) )
+// One param per line: "type name [: usage]". Every line is checked and its errors reported,
+// the params are only usable if it returns true. The locations are resolved once linked.
+static bool parse_shader_params( const RFBlock& block, const char* source_file, std::vector<ShaderParam>& out_params )
+{
+    bool is_valid = true;
+    RFLexer lexer = make_lexer( block );
+    while( next_lexer_line( lexer ) )
     {
-        for(uint i=0; i<ARRAY_SIZE(s_ShaderParamUsageStringTable); ++i)
+        RFToken type_token, name_token, token;
+        next_token( lexer, type_token );
+
+        ShaderParam param;
+        param.location = 0;
+        param.usage    = ShaderParamUsage::CUSTOM;
+
+        const char* error = nullptr;
+        if( !find_in_string_table( s_ShaderParamTypeStringTable, type_token.text, param.type ) || param.type == ShaderParamType::UNKNOWN )
+        {
+            error = "Unknown param type";
+            token = type_token;
+        }
+        else if( !next_token( lexer, name_token ) || name_token.text == ":" )
         {
-            auto usage_str = s_ShaderParamUsageStringTable[i];
-            if( strcmp(usage_str, usage) == 0 )
+            error = "Missing param name";
+            token = name_token.text == ":" ? name_token : get_line_end_token( lexer );
+        }
+        else if( next_token( lexer, token ) )
+        {
+            if( !( token.text == ":" ) )
+            {
+                error = "Expected ':' before the usage, found";
+            }
+            else if( !next_token( lexer, token ) )
             {
-                param.usage = (ShaderParamUsage)i;
-                break;
+                error = "Missing param usage";
+                token = get_line_end_token( lexer );
             }
+            else if( !find_in_string_table( s_ShaderParamUsageStringTable, token.text, param.usage ) )
+                error = "Unknown param usage";
+            else if( next_token( lexer, token ) )
+                error = "Unexpected token after the usage";
         }
-    }
-    else
-    {
-        param.usage = ShaderParamUsage::CUSTOM;
-    }
 
-    return param;
-}
+        if( error != nullptr )
+        {
+            report_token_error( source_file, token, error );
+            is_valid = false;
+            continue;
+        }
 
+        param.name = intern_string( name_token.text.begin(), name_token.text.end() );
+        out_params.push_back( param );
+    }
+    return is_valid;
+}
 
-static void extract_shader_params( uint program, std::vector<ShaderParam>& params, const char* param_block )
+static void extract_shader_params( uint program, std::vector<ShaderParam>& params, const std::vector<ShaderParam>& custom_params )
 {
     int location = -1;
 
@@ -132,68 +170,19 @@ static void extract_shader_params( uint program, std::vector<ShaderParam>& param
         if( location > -1 )
         {
             params.emplace_back( ShaderParam {
-                param.name, (uint)location,
+                intern_string( param.name ), (uint)location,
                 get_shader_param_type_from_usage( param.usage ),
                 param.usage
              } );
         }
     }
 
-    // check custom params
-    const char* params_ptr = param_block;
-    if( !is_eof_or_nil(params_ptr) ) while( true )
+    // custom params, already parsed from the params block
+    for( auto param : custom_params )
     {
-        params_ptr = chomp_empty_space( params_ptr );
-        if( is_eof( *params_ptr ) )
-            break;
-
-        if( is_new_line( *params_ptr ) )
-        {
-            ++params_ptr;
-            continue;
-        }
-
-        const char* token_end = params_ptr;
-        token_end = chomp_token(token_end);
-        std::string type_token(params_ptr, token_end);
-        
-        params_ptr = chomp_empty_space( token_end );
-        token_end  = chomp_token( params_ptr );
-        std::string param_name( params_ptr, token_end );
-
-        // @Cleanup: NO SANITY CHECKS ARE DONE !!!
-        // @Cleanup: NO SANITY CHECKS ARE DONE !!!
-        // @Cleanup: NO SANITY CHECKS ARE DONE !!!
-
-        params_ptr = chomp_empty_space( token_end );
-        std::string usage_token;
-        if( !is_new_line( *params_ptr ) )
-        {
-            params_ptr = chomp_empty_space( params_ptr );
-            
-            if( *params_ptr == ':' )
-            {
-                params_ptr++;
-                params_ptr = chomp_empty_space( params_ptr );
-                token_end = chomp_token( params_ptr );
-                usage_token.assign( params_ptr, token_end );
-            }
-
-            params_ptr = chomp_empty_space( params_ptr );
-        }
-
         // @Cleanup: can location be an attrib ?
-        params.emplace_back( 
-            make_shader_param ( 
-                param_name.c_str(),
-                glGetUniformLocation( program, param_name.c_str() ), 
-                type_token.c_str(),
-                usage_token.c_str() 
-            )
-        );
-
-        assert( is_new_line( *params_ptr ), "ERROR: Must be newline at this point." );
-        params_ptr++;
+        param.location = glGetUniformLocation( program, resolve_string( param.name ) );
+        params.push_back( param );
     }
 }
 
@@ -205,12 +194,55 @@ char* extract_shader_name( const char* file, char* buffer, uint buffer_length )
 
 static Shader* find_shader( MemoryPool<Shader>& shader_pool, const char* name )
 {
-    for(auto shader : shader_pool)
+    auto& resource_pool = get_dll_appdata().global_store.resource_pool;
+    assert( &get_resource_pool<Shader>( resource_pool ) == &shader_pool, "find_shader only knows the names of the global shader pool." );
+    return find_resource<Shader>( resource_pool, name );
+}
+
+// 0 if the stage doesn't compile
+static uint compile_shader_stage( uint stage_type, const RFBlock& block, const char* stage_name, const char* source_file )
+{
+    uint stage = glCreateShader(stage_type);
+    // the blocks are views into the file, the lengths are given as they aren't null terminated
+    const char* source_ptr = block.content.data();
+    int source_length = (int)block.content.size();
+    glShaderSource(stage, 1, &source_ptr, &source_length);
+    glCompileShader(stage);
+
+    int success;
+    glGetShaderiv(stage, GL_COMPILE_STATUS, &success);
+    if(!success)
     {
-        if( shader->name == name )
-            return shader;
+        char info_log[512];
+        glGetShaderInfoLog(stage, 512, nullptr, info_log);
+        println("ERROR: Compilation of % shader failed. File: %. Reason: \n%", stage_name, source_file, info_log);
+        glDeleteShader(stage);
+        return 0;
     }
-    return nullptr;
+    return stage;
+}
+
+// 0 if the program doesn't link, the stages are left to the caller
+static uint link_shader_program( uint vertex_shader, uint fragment_shader, const char* source_file )
+{
+    uint shader_program = glCreateProgram();
+    glAttachShader(shader_program, vertex_shader);
+    glAttachShader(shader_program, fragment_shader);
+    glLinkProgram(shader_program);
+
+    int success;
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    glDetachShader(shader_program, vertex_shader);
+    glDetachShader(shader_program, fragment_shader);
+    if(!success)
+    {
+        char info_log[512];
+        glGetProgramInfoLog(shader_program, 512, nullptr, &info_log[0]);
+        println("ERROR: Linking of program shader failed. File: %. Reason: \n%", source_file, info_log);
+        glDeleteProgram(shader_program);
+        return 0;
+    }
+    return shader_program;
 }
 
 Shader* load_shader( MemoryPool<Shader>& shader_pool, const char* source_file )
@@ -219,7 +251,13 @@ Shader* load_shader( MemoryPool<Shader>& shader_pool, const char* source_file )
     std::string FRAGMENT_SHADER_TOKEN = "fragment";
     std::string PARAMS_TOKEN = "params";
 
-    ResourceFile file = parse_resource_file( source_file );
+    char shader_name[512];
+    extract_shader_name( source_file, shader_name, 512 );
+    Shader* shader = find_shader( shader_pool, shader_name );
+    bool reloaded = shader != nullptr;
+
+    // on reload only what changed since the last load is rebuilt
+    ResourceFile file = reloaded ? reparse_resource_file( source_file, shader->source_digest ) : parse_resource_file( source_file );
     if( !file.is_valid )
     {
         println( "Error: Unable to read the shader %.", source_file );
@@ -252,82 +290,79 @@ Shader* load_shader( MemoryPool<Shader>& shader_pool, const char* source_file )
         return nullptr;
     }
 
-    bool shader_compile_error = false, shader_link_error = false;
-    int success;
-    std::vector<const char*> source_array(1);
-    char info_log[512];
-
-    uint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    const char* source_ptr = vertex_shader_block->content.c_str();
-    glShaderSource(vertex_shader, 1, &source_ptr, nullptr);
-    glCompileShader(vertex_shader);
-
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if(!success)
+    // a bad params block rejects the file before anything is compiled
+    std::vector<ShaderParam> custom_params;
+    if( params_block && !parse_shader_params( *params_block, source_file, custom_params ) )
     {
-        glGetShaderInfoLog(vertex_shader, 512, nullptr, info_log);
-        println("ERROR: Compilation of vertex shader failed. File: %. Reason: \n%", source_file, info_log);
-        shader_compile_error = true;
+        println("ERROR: Invalid params in shader %.", source_file);
+        return nullptr;
     }
 
-    uint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    source_ptr = fragment_shader_block->content.c_str();
-    glShaderSource(fragment_shader, 1, &source_ptr, nullptr);
-    glCompileShader(fragment_shader);
+    bool vertex_changed   = vertex_shader_block->changed;
+    bool fragment_changed = fragment_shader_block->changed;
+    bool params_changed   = params_block ? params_block->changed : reloaded && find_block_digest( shader->source_digest, PARAMS_TOKEN.c_str() ) != nullptr;
+    bool relinked         = vertex_changed || fragment_changed;
 
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if(!success)
+    if( relinked )
     {
-        glGetShaderInfoLog(fragment_shader, 512, nullptr, info_log);
-        println("ERROR: Compilition of fragment shader failed. File: %. Reason: \n%", source_file, info_log);
-        shader_compile_error = true;
-    }
+        LoadPhaseTimer compile_timer( source_file, LoadPhase::DECODE );
 
-    if(shader_compile_error)
-    {
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
-        return nullptr;
-    }
+        // an unchanged stage is linked again as it is, only a first load compiles both
+        uint vertex_shader   = vertex_changed   ? compile_shader_stage( GL_VERTEX_SHADER, *vertex_shader_block, "vertex", source_file ) : shader->vertex_shader;
+        uint fragment_shader = fragment_changed ? compile_shader_stage( GL_FRAGMENT_SHADER, *fragment_shader_block, "fragment", source_file ) : shader->fragment_shader;
 
-    uint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
+        uint shader_program = 0;
+        if( vertex_shader != 0 && fragment_shader != 0 )
+            shader_program = link_shader_program( vertex_shader, fragment_shader, source_file );
 
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-    if(!success)
-    {
-        glGetProgramInfoLog(shader_program, 512, nullptr, &info_log[0]);
-        println("ERROR: Linking of program shader failed. File: %. Reason: \n%", source_file, info_log);
-        shader_link_error = true;
-    }
+        if( shader_program == 0 )
+        {
+            // the stages that weren't compiled here still belong to the shader
+            if( vertex_changed )   glDeleteShader( vertex_shader );
+            if( fragment_changed ) glDeleteShader( fragment_shader );
+            return nullptr;
+        }
 
-    glDetachShader(shader_program, vertex_shader);
-    glDetachShader(shader_program, fragment_shader);
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+        if( reloaded )
+        {
+            glDeleteProgram( shader->program );
+            if( vertex_changed )   glDeleteShader( shader->vertex_shader );
+            if( fragment_changed ) glDeleteShader( shader->fragment_shader );
+        }
+        else
+        {
+            shader = shader_pool.Instantiate();
+            assert( shader != nullptr, "Allocation error." );
+        }
 
-    if(shader_link_error)
-    {
-        glDeleteProgram(shader_program);
-        return nullptr;
+        shader->program         = shader_program;
+        shader->vertex_shader   = vertex_shader;
+        shader->fragment_shader = fragment_shader;
     }
 
-    char shader_name[512];
-    extract_shader_name( source_file, shader_name, 512 );
-    Shader* shader = find_shader( shader_pool, shader_name );
-    if( shader ) glDeleteProgram( shader->program );
-    else shader = shader_pool.Instantiate();
-    assert( shader != nullptr, "Allocation error." );
-
     setup_resource( shader, source_file, shader_name );
-    shader->program           = shader_program;
-    extract_shader_params( shader->program, shader->params, params_block ? params_block->content.c_str() : nullptr );
+    shader->source_digest = get_resource_file_digest( file );
+
+    // a new program moves the locations, the params are extracted again with it
+    if( relinked || params_changed )
+    {
+        shader->params.clear();
+        extract_shader_params( shader->program, shader->params, custom_params );
+
+        // the materials using it rebind their params
+        if( reloaded )
+            invalidate_dependents( shader );
+    }
 
     return shader;
 }
 
+static void reload_shader( Resource* resource )
+{
+    load_shader( get_resource_pool<Shader>( get_dll_appdata().global_store.resource_pool ), resolve_string( resource->source->source ) );
+}
+REGISTER_RESOURCE_RELOADER( Shader, reload_shader );
+
 static Variant variant_from_shader_type( ShaderParamType type )
 {
     switch( type )
@@ -344,19 +379,20 @@ static Variant variant_from_shader_type( ShaderParamType type )
 static MaterialParam material_param_from_shader_param( ShaderParam& param )
 {
     return MaterialParam {
-        param.name.c_str(),
+        param.name,
         param.location,
         param.type,
         variant_from_shader_type( param.type ),
     };
 }
 
-Material* create_material( MemoryPool<Material>& material_pool, Shader* shader )
+// builds the params from the custom params of the shader, keeping the values of the
+// previous params with the same name and type
+static void bind_material_params( Material* material )
 {
-    assert( shader != nullptr, "Shader must have a value." );
-
-    auto mat = material_pool.Instantiate();
-    mat->shader = shader;
+    auto shader = material->shader;
+    std::vector<MaterialParam> previous_params;
+    previous_params.swap( material->param_instances );
 
     uint shader_param_size = (uint)shader->params.size();
     uint custom_param_count = 0;
@@ -373,24 +409,158 @@ Material* create_material( MemoryPool<Material>& material_pool, Shader* shader )
 
     if( custom_param_count > 0 )
     {
-        mat->param_instances.reserve( custom_param_count );
+        material->param_instances.reserve( custom_param_count );
         for( uint i = custom_param_begin; i < shader_param_size; ++i )
-            mat->param_instances.emplace_back( material_param_from_shader_param( shader->params[i] ) );
+        {
+            auto param = material_param_from_shader_param( shader->params[i] );
+            for( auto& previous : previous_params )
+            {
+                if( previous.name == param.name && previous.type == param.type )
+                {
+                    param.value   = previous.value;
+                    param.texture = previous.texture;
+                    previous.texture = nullptr; // the reference moves with it
+                    break;
+                }
+            }
+            material->param_instances.emplace_back( param );
+        }
+    }
+
+    // textures of params the shader dropped aren't used anymore
+    for( auto& previous : previous_params )
+    {
+        if( previous.texture == nullptr )
+            continue;
+
+        release_resource( previous.texture );
+        bool still_used = false;
+        for( auto& param : material->param_instances )
+            still_used = still_used || param.texture == previous.texture;
+        if( !still_used )
+            remove_dependency( material, previous.texture );
     }
+}
+
+static bool on_material_dependency_changed( void* dependent, const void* dependency )
+{
+    auto material = static_cast<Material*>( dependent );
+    if( dependency == material->shader )
+    {
+        bind_material_params( material );
+        return true;
+    }
+
+    bool changed = false;
+    for( auto& param : material->param_instances )
+    {
+        if( param.texture == dependency )
+        {
+            param.value = (u32)param.texture->buffer;
+            changed = true;
+        }
+    }
+    return changed;
+}
+REGISTER_DEPENDENCY_HANDLER( MATERIAL, on_material_dependency_changed );
+
+Material* create_material( MemoryPool<Material>& material_pool, Shader* shader )
+{
+    assert( shader != nullptr, "Shader must have a value." );
+
+    auto mat = material_pool.Instantiate();
+    mat->shader = shader;
+    acquire_resource( shader );
+    bind_material_params( mat );
+    add_dependency( mat, DependentKind::MATERIAL, shader );
 
     return mat;
 }
 
+void destroy_material( MemoryPool<Material>& material_pool, Material* material )
+{
+    for( auto& param : material->param_instances )
+    {
+        if( param.texture )
+            release_resource( param.texture );
+    }
+    release_resource( material->shader );
+    remove_dependencies( material );
+
+    material_pool.Destroy( material );
+}
+
 void set_material_param( Material* material, const char* param_name, Variant value )
+{
+    set_material_param( material, find_string( param_name ), value );
+}
+
+// keeps the references and the dependency of the material on the textures of its params up to date
+static void set_param_texture( Material* material, MaterialParam& param, Texture* texture )
+{
+    Texture* previous = param.texture;
+    param.texture = texture;
+    if( texture )
+    {
+        acquire_resource( texture );
+        add_dependency( material, DependentKind::MATERIAL, texture );
+    }
+
+    if( previous == nullptr )
+        return;
+
+    release_resource( previous );
+    if( previous == texture )
+        return;
+
+    for( auto& other : material->param_instances )
+    {
+        if( other.texture == previous )
+            return;
+    }
+    remove_dependency( material, previous );
+}
+
+void set_material_param( Material* material, StringId param_name, Variant value )
 {
     for( auto& param : material->param_instances )
     {
-        if( strcmp( param.name, param_name ) == 0 )
+        if( param.name == param_name )
         {
             if( value.type != param.value.type )
+            {
                 println( "Tried to set material param with the wrong variant type, received: %, expected: %.", value.type, param.value.type );
+            }
             else
+            {
+                set_param_texture( material, param, nullptr );
                 param.value = value;
+            }
+            break;
+        }
+    }
+}
+
+void set_material_param( Material* material, const char* param_name, Texture* texture )
+{
+    set_material_param( material, find_string( param_name ), texture );
+}
+
+void set_material_param( Material* material, StringId param_name, Texture* texture )
+{
+    for( auto& param : material->param_instances )
+    {
+        if( param.name == param_name )
+        {
+            if( param.type != ShaderParamType::TEXTURE2D )
+            {
+                println( "Tried to set a texture on the material param %, it isn't a texture.", resolve_string( param_name ) );
+            }
+            else
+            {
+                set_param_texture( material, param, texture );
+                param.value = texture ? (u32)texture->buffer : (u32)-1;
+            }
             break;
         }
     }
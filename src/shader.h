@@ -10,6 +10,7 @@
 #include "basics.h"
 #include "resource.h"
 #include "memory_pool.h"
+#include "file_parser.h"
 
 enum class ShaderParamType : ushort
 {
@@ -44,7 +45,7 @@ const char* to_string( ShaderParamUsage usage );
 
 struct ShaderParam
 {
-    std::string name;
+    StringId    name;
     uint        location;
     ShaderParamType  type;
     ShaderParamUsage usage;
@@ -56,14 +57,23 @@ struct Shader : public Resource
 
     uint program = 0;
     std::vector<ShaderParam> params;
+
+    // the stages are kept, a reload only compiles the ones whose block changed
+    uint vertex_shader   = 0;
+    uint fragment_shader = 0;
+    ResourceFileDigest source_digest;
 };
+template<> constexpr u32 get_pool_size<Shader>() { return get_page_fitting_pool_size<Shader>(); }
+
+struct Texture;
 
 struct MaterialParam
 {
-    const char* name = nullptr;
+    StringId name = INVALID_STRING_ID;
     uint location = 0;
     ShaderParamType type = ShaderParamType::UNKNOWN;
     Variant value;
+    Texture* texture = nullptr; // value follows its GL name when set with a Texture
 };
 
 struct Material
@@ -71,9 +81,16 @@ struct Material
     Shader* shader;
     std::vector<MaterialParam> param_instances;
 };
+template<> constexpr u32 get_pool_size<Material>() { return get_page_fitting_pool_size<Material>(); }
 
+// the material follows its shader and its textures when they are reloaded, see resource_dependencies.h
+// it holds a reference on them until it is destroyed, see resource_budget.h
 Material* create_material( MemoryPool<Material>& material_pool, Shader* shader );
+void destroy_material( MemoryPool<Material>& material_pool, Material* material );
+void set_material_param( Material* material, StringId param_name, Variant value );
 void set_material_param( Material* material, const char* param_name, Variant value );
+void set_material_param( Material* material, StringId param_name, Texture* texture );
+void set_material_param( Material* material, const char* param_name, Texture* texture );
 
 char* extract_shader_name( const char* file, char* buffer, uint buffer_length );
 Shader* load_shader( MemoryPool<Shader>& shader_pool, const char* source_file );
@@ -0,0 +1,88 @@
+#include "soa_pool.h"
+
+#include <algorithm>
+
+#include "type_db.h"
+
+// size of a member from its type, 0 when the metadata doesn't tell
+static u32 get_field_size( const TypeInfo* type, bool is_pointer )
+{
+    if( is_pointer )
+        return sizeof( void* );
+
+    if( type == nullptr )
+        return 0;
+
+    switch( type->type )
+    {
+        case TypeInfoType::Scalar:
+            return type->scalar_info.size;
+        case TypeInfoType::Struct:
+            return type->struct_info.size;
+        case TypeInfoType::Enum:
+            if( type->enum_info.underlying_type && type->enum_info.underlying_type->type == TypeInfoType::Scalar )
+                return type->enum_info.underlying_type->scalar_info.size;
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static void collect_soa_fields( const TypeInfo* type, std::vector<SoAField>& fields )
+{
+    const StructInfo& struct_info = type->struct_info;
+    if( struct_info.parent )
+        collect_soa_fields( struct_info.parent, fields );
+
+    for( uint i = 0; i < struct_info.field_count; ++i )
+    {
+        const auto& field = struct_info.fields[i];
+        assert_fmt( !( field.modifier & FieldInfoModifier::REFERENCE ), "SoAPool: reference member % can't be stored.", field.name );
+
+        SoAField soa_field;
+        soa_field.name    = field.name;
+        soa_field.type_id = field.type ? field.type->type_id : INVALID_TYPE_ID;
+        soa_field.offset  = (u32)field.offset;
+        soa_field.size    = get_field_size( field.type, ( field.modifier & FieldInfoModifier::POINTER ) != 0 );
+        fields.push_back( soa_field );
+    }
+}
+
+std::vector<SoAField> get_soa_fields( const TypeInfo* type )
+{
+    assert( type && type->type == TypeInfoType::Struct, "SoAPool only handles struct types." );
+
+    std::vector<SoAField> fields;
+    collect_soa_fields( type, fields );
+
+    std::stable_sort( fields.begin(), fields.end(), []( const SoAField& a, const SoAField& b ) { return a.offset < b.offset; } );
+
+    std::vector<SoAField> packed_fields;
+    u32 covered_end = 0;
+    for( uint i = 0; i < fields.size(); ++i )
+    {
+        SoAField& field = fields[i];
+        if( !packed_fields.empty() && field.offset < covered_end )
+            continue;
+
+        // unknown types take the space up to the next member
+        if( field.size == 0 )
+        {
+            u32 next_offset = type->struct_info.size;
+            for( uint j = i + 1; j < fields.size(); ++j )
+            {
+                if( fields[j].offset > field.offset )
+                {
+                    next_offset = fields[j].offset;
+                    break;
+                }
+            }
+            field.size = next_offset - field.offset;
+        }
+
+        covered_end = field.offset + field.size;
+        packed_fields.push_back( field );
+    }
+
+    return packed_fields;
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <type_traits>
+
+#include "basic_types.h"
+#include "basics.h"
+#include "types.h"
+#include "memory_pool.h"
+
+#define INVALID_SOA_FIELD 4294967295
+
+template<typename T> class SoAPool;
+
+// One member of a struct stored in its own array by SoAPool.
+// Only ids and a copy of the name are kept so the layout survives metadata reloads.
+struct SoAField
+{
+    std::string name;
+    TypeId type_id = INVALID_TYPE_ID;
+    u32    offset  = 0; // offset of the member in the struct
+    u32    size    = 0; // size of one element of the field array
+};
+
+// Members of a struct, parents first, sorted by offset. Members overlapping a previous
+// one (unions) are skipped, the first one covers them.
+std::vector<SoAField> get_soa_fields( const TypeInfo* type );
+
+template<typename F>
+struct SoASpan
+{
+    F*  data  = nullptr;
+    u32 count = 0;
+
+    F* begin() const { return data; }
+    F* end()   const { return data + count; }
+    F& operator[]( u32 idx ) const { return data[idx]; }
+};
+
+// Proxy to an element of a SoAPool, reads and writes go through the field arrays.
+template<typename T>
+class SoARef
+{
+private:
+    SoAPool<T>* pool = nullptr;
+    u32 dense_idx    = 0;
+
+public:
+    SoARef( SoAPool<T>* pool, u32 dense_idx ) : pool( pool ), dense_idx( dense_idx ) {}
+
+    template<typename F>
+    F& field( u32 field_idx ) const
+    {
+        return pool->template Field<F>( field_idx )[ dense_idx ];
+    }
+
+    T load() const
+    {
+        T value;
+        for( u32 field_idx = 0; field_idx < (u32)pool->fields.size(); ++field_idx )
+        {
+            const SoAField& field = pool->fields[ field_idx ];
+            memcpy( reinterpret_cast<u8*>( &value ) + field.offset, pool->arrays[ field_idx ] + dense_idx * field.size, field.size );
+        }
+        return value;
+    }
+
+    void store( const T& value ) const
+    {
+        for( u32 field_idx = 0; field_idx < (u32)pool->fields.size(); ++field_idx )
+        {
+            const SoAField& field = pool->fields[ field_idx ];
+            memcpy( pool->arrays[ field_idx ] + dense_idx * field.size, reinterpret_cast<const u8*>( &value ) + field.offset, field.size );
+        }
+    }
+
+    operator T() const { return load(); }
+    const SoARef<T>& operator=( const T& value ) const { store( value ); return *this; }
+};
+
+// Pool storing each member of T in its own packed array, the layout comes from the
+// generated TypeInfo. Live elements are kept dense with swap-remove so the field
+// arrays can be fed directly to vectorized loops. Elements are referenced with
+// generational PoolHandles that go through a slot table.
+// @Note: Only for trivially copyable types, elements are moved around with memcpy.
+template<typename T>
+class SoAPool
+{
+    static_assert( std::is_trivially_copyable<T>::value, "SoAPool only stores trivially copyable types." );
+    friend class SoARef<T>;
+
+private:
+    std::vector<SoAField> fields;
+    std::vector<u8*>      arrays; // one per field, capacity elements each
+
+    u32 count    = 0;
+    u32 capacity = 0;
+
+    std::vector<u32> dense_to_slot;
+    std::vector<u32> slot_to_dense;
+    std::vector<u32> slot_generation; // never 0, see INVALID_POOL_HANDLE
+    std::vector<u32> free_slots;
+
+    void Grow()
+    {
+        u32 new_capacity = capacity == 0 ? 64 : capacity * 2;
+        for( u32 field_idx = 0; field_idx < (u32)fields.size(); ++field_idx )
+        {
+            u8* new_array = new u8[ (size_t)new_capacity * fields[ field_idx ].size ];
+            if( arrays[ field_idx ] )
+            {
+                memcpy( new_array, arrays[ field_idx ], (size_t)count * fields[ field_idx ].size );
+                delete[] arrays[ field_idx ];
+            }
+            arrays[ field_idx ] = new_array;
+        }
+        capacity = new_capacity;
+    }
+
+    u32 DenseIndex( PoolHandle handle ) const
+    {
+        u32 slot = get_pool_handle_index( handle );
+        if( slot >= slot_to_dense.size() || slot_generation[ slot ] != get_pool_handle_generation( handle ) )
+            return max_value<u32>();
+        return slot_to_dense[ slot ];
+    }
+
+public:
+    SoAPool( const TypeInfo* type )
+        : fields( get_soa_fields( type ) )
+    {
+        assert_fmt( type->struct_info.size == sizeof(T), "SoAPool: metadata of % doesn't match the compiled type.", type->name );
+        arrays.resize( fields.size(), nullptr );
+    }
+
+    ~SoAPool()
+    {
+        for( auto* array : arrays )
+            delete[] array;
+        arrays.clear();
+    }
+
+    SoAPool( const SoAPool& ) = delete;
+    SoAPool& operator=( const SoAPool& ) = delete;
+
+    PoolHandle Instantiate( const T& value = {} )
+    {
+        if( count == capacity )
+            Grow();
+
+        u32 slot;
+        if( !free_slots.empty() )
+        {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        else
+        {
+            slot = (u32)slot_to_dense.size();
+            slot_to_dense.push_back( 0 );
+            slot_generation.push_back( 1 );
+        }
+
+        u32 dense_idx = count++;
+        slot_to_dense[ slot ] = dense_idx;
+        dense_to_slot.push_back( slot );
+        SoARef<T>( this, dense_idx ).store( value );
+
+        return make_pool_handle( slot, slot_generation[ slot ] );
+    }
+
+    void Destroy( PoolHandle handle )
+    {
+        u32 dense_idx = DenseIndex( handle );
+        assert( dense_idx != max_value<u32>(), "Error: Tried to destroy something with a stale handle." );
+
+        // move the last element in the hole to stay dense
+        u32 last_idx = count - 1;
+        if( dense_idx != last_idx )
+        {
+            for( u32 field_idx = 0; field_idx < (u32)fields.size(); ++field_idx )
+            {
+                u32 size = fields[ field_idx ].size;
+                memcpy( arrays[ field_idx ] + dense_idx * size, arrays[ field_idx ] + last_idx * size, size );
+            }
+            dense_to_slot[ dense_idx ] = dense_to_slot[ last_idx ];
+            slot_to_dense[ dense_to_slot[ dense_idx ] ] = dense_idx;
+        }
+        dense_to_slot.pop_back();
+        count--;
+
+        u32 slot = get_pool_handle_index( handle );
+        if( ++slot_generation[ slot ] == 0 )
+            slot_generation[ slot ] = 1;
+        free_slots.push_back( slot );
+    }
+
+    bool IsValid( PoolHandle handle ) const
+    {
+        return DenseIndex( handle ) != max_value<u32>();
+    }
+
+    SoARef<T> Get( PoolHandle handle )
+    {
+        u32 dense_idx = DenseIndex( handle );
+        assert( dense_idx != max_value<u32>(), "Error: Tried to get something with a stale handle." );
+        return SoARef<T>( this, dense_idx );
+    }
+
+    // dense access, indices change when elements are destroyed
+    SoARef<T> operator[]( u32 dense_idx )
+    {
+        assert( dense_idx < count, "Error: SoAPool index out of range." );
+        return SoARef<T>( this, dense_idx );
+    }
+
+    PoolHandle HandleAt( u32 dense_idx ) const
+    {
+        u32 slot = dense_to_slot[ dense_idx ];
+        return make_pool_handle( slot, slot_generation[ slot ] );
+    }
+
+    u32 Count() const { return count; }
+
+    u32 FieldCount() const { return (u32)fields.size(); }
+    const SoAField& GetField( u32 field_idx ) const { return fields[ field_idx ]; }
+
+    u32 FieldIndex( const char* name ) const
+    {
+        for( u32 field_idx = 0; field_idx < (u32)fields.size(); ++field_idx )
+            if( fields[ field_idx ].name == name )
+                return field_idx;
+        return INVALID_SOA_FIELD;
+    }
+
+    // the Count() live values of a member, packed
+    template<typename F>
+    SoASpan<F> Field( u32 field_idx )
+    {
+        assert( field_idx < fields.size(), "Error: SoAPool field index out of range." );
+        assert_fmt( sizeof(F) == fields[ field_idx ].size, "Error: SoAPool field % accessed with the wrong type.", fields[ field_idx ].name.c_str() );
+        return SoASpan<F> { reinterpret_cast<F*>( arrays[ field_idx ] ), count };
+    }
+
+    SoASpan<u8> RawField( u32 field_idx )
+    {
+        return SoASpan<u8> { arrays[ field_idx ], count * fields[ field_idx ].size };
+    }
+};
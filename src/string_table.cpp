@@ -0,0 +1,83 @@
+#include "string_table.h"
+
+#include <string.h>
+
+#include "basics.h"
+#include "dll.h"
+
+#define STRING_TABLE_CHUNK_SIZE ( 64 * 1024 )
+
+const char* StringTable::Store( const char* text, u32 length )
+{
+    // long texts get their own allocation so the current chunk keeps filling up
+    if( length + 1 > STRING_TABLE_CHUNK_SIZE / 4 )
+    {
+        char* large_string = new char[ length + 1 ];
+        large_strings.push_back( large_string );
+        memcpy( large_string, text, length );
+        large_string[ length ] = '\0';
+        return large_string;
+    }
+
+    if( chunks.empty() || chunk_used + length + 1 > STRING_TABLE_CHUNK_SIZE )
+    {
+        chunks.push_back( new char[ STRING_TABLE_CHUNK_SIZE ] );
+        chunk_used = 0;
+    }
+
+    char* stored = chunks.back() + chunk_used;
+    memcpy( stored, text, length );
+    stored[ length ] = '\0';
+    chunk_used += length + 1;
+    return stored;
+}
+
+StringId StringTable::Intern( const char* text, u32 length )
+{
+    StringId id = Find( text, length );
+    if( id != INVALID_STRING_ID || length == 0 )
+        return id;
+
+    id = (StringId)strings.size();
+    strings.push_back( Store( text, length ) );
+    index.Insert( hash_name( text, length ), reinterpret_cast<void*>( (uintptr_t)id ) );
+    return id;
+}
+
+StringId StringTable::Find( const char* text, u32 length ) const
+{
+    if( length == 0 )
+        return INVALID_STRING_ID;
+
+    void* value = index.Find( hash_name( text, length ), [this, text, length]( void* value ) {
+        const char* stored = strings[ (uintptr_t)value ];
+        return memcmp( stored, text, length ) == 0 && stored[ length ] == '\0';
+    } );
+    return (StringId)(uintptr_t)value;
+}
+
+const char* StringTable::Resolve( StringId id ) const
+{
+    assert( id < strings.size(), "Error: Unknown string id." );
+    return strings[ id ];
+}
+
+StringId intern_string( const char* text )
+{
+    return get_dll_appdata().global_store.strings.Intern( text, (u32)strlen( text ) );
+}
+
+StringId intern_string( const char* begin, const char* end )
+{
+    return get_dll_appdata().global_store.strings.Intern( begin, (u32)( end - begin ) );
+}
+
+StringId find_string( const char* text )
+{
+    return get_dll_appdata().global_store.strings.Find( text, (u32)strlen( text ) );
+}
+
+const char* resolve_string( StringId id )
+{
+    return get_dll_appdata().global_store.strings.Resolve( id );
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "basic_types.h"
+#include "name_index.h"
+
+typedef u32 StringId;
+#define INVALID_STRING_ID 0 // also the id of the empty string
+
+// Interned strings: each distinct text is stored once and named by a StringId, so names
+// compare as integers. Texts are packed in chunks that never move and ids are never
+// reused, the table lives in Appdata so ids stay valid across dll reloads.
+class StringTable
+{
+private:
+    std::vector<const char*> strings; // by id
+    std::vector<char*> chunks;
+    std::vector<char*> large_strings;
+    u32 chunk_used = 0; // bytes used in the last chunk
+
+    NameIndex index; // the values are the ids
+
+    const char* Store( const char* text, u32 length );
+
+public:
+    // inline, the app owns the table and builds it before the dll is loaded
+    StringTable()
+    {
+        strings.push_back( "" );
+    }
+
+    ~StringTable()
+    {
+        for( auto* chunk : chunks )
+            delete[] chunk;
+        for( auto* large_string : large_strings )
+            delete[] large_string;
+        chunks.clear();
+        large_strings.clear();
+    }
+
+    StringTable( const StringTable& ) = delete;
+    StringTable& operator=( const StringTable& ) = delete;
+
+    StringId Intern( const char* text, u32 length );
+    StringId Find( const char* text, u32 length ) const; // INVALID_STRING_ID if it was never interned
+    const char* Resolve( StringId id ) const;
+
+    u32 Count() const { return (u32)strings.size(); }
+};
+
+// helpers on the table of the app, intern at load time and resolve only for UI and logs
+StringId intern_string( const char* text );
+StringId intern_string( const char* begin, const char* end );
+StringId find_string( const char* text ); // doesn't grow the table, for lookups by name
+const char* resolve_string( StringId id );
@@ -0,0 +1,291 @@
+#include "text_scanner.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define TEXT_SCAN_X86
+#include <immintrin.h>
+#endif
+
+// @Platform: gcc and clang only emit AVX2 in functions built for it, msvc always can
+#if defined(TEXT_SCAN_X86) && defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+static const u64 CHUNK_SIZE = 64; // one bit per byte in the masks
+
+struct ChunkMasks
+{
+    u64 new_lines;
+    u64 colons;
+};
+
+struct BlockScanner
+{
+    const char* data;
+    u64         size;
+    TextScan&   scan;
+    u64         line_start; // offset of the line the chunk starts in
+    uint        line_count; // '\n' before line_start
+};
+
+struct TextScanFunctions
+{
+    TextScanIsa isa;
+    u64 ( *scan_blocks )( BlockScanner& scanner ); // returns the offset of the tail, shorter than a chunk
+    const char* ( *scan_new_line )( const char* ptr, const char* end );
+};
+
+static TextScanFunctions& get_text_scan_functions();
+
+static bool is_name_end( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// colons are rare, only them go back to the bytes
+static void add_header( BlockScanner& scanner, u64 line_start, u64 colon, uint line_number )
+{
+    const char* data = scanner.data;
+    for( u64 i = line_start; i < colon; ++i )
+    {
+        if( data[i] != ' ' && data[i] != '\t' )
+            return;
+    }
+
+    const char* end  = data + scanner.size;
+    const char* name = data + colon + 1;
+    const char* name_end = name;
+    while( name_end < end && !is_name_end( *name_end ) ) ++name_end;
+
+    const char* content = get_text_scan_functions().scan_new_line( name_end, end );
+    if( content < end )
+        ++content;
+
+    scanner.scan.headers.push_back( { data + line_start, name, (u32)( name_end - name ), content, line_number } );
+}
+
+static inline void add_chunk( BlockScanner& scanner, u64 offset, ChunkMasks masks )
+{
+    for( u64 colons = masks.colons; colons != 0; colons &= colons - 1 )
+    {
+        u32 bit = count_trailing_zeros( colons );
+        u64 new_lines_before = masks.new_lines & ( ( u64(1) << bit ) - 1 );
+        u64 line_start = new_lines_before != 0 ? offset + index_of_highest_bit( new_lines_before ) + 1 : scanner.line_start;
+        add_header( scanner, line_start, offset + bit, scanner.line_count + count_set_bits( new_lines_before ) + 1 );
+    }
+
+    if( masks.new_lines != 0 )
+    {
+        scanner.line_start  = offset + index_of_highest_bit( masks.new_lines ) + 1;
+        scanner.line_count += count_set_bits( masks.new_lines );
+    }
+}
+
+// one bit per byte of the word equal to value, in byte order
+// @Note: SWAR, exact for every byte so there is no false positive to filter. Assumes a little endian host.
+static u64 match_bytes( u64 word, u64 value )
+{
+    const u64 low_bits = 0x7F7F7F7F7F7F7F7Full;
+
+    u64 zeroes = word ^ ( value * 0x0101010101010101ull );
+    zeroes = ~( ( ( zeroes & low_bits ) + low_bits ) | zeroes | low_bits ); // 0x80 in every zero byte
+    return ( ( zeroes >> 7 ) * 0x0102040810204080ull ) >> 56;
+}
+
+static ChunkMasks scan_chunk_scalar( const char* ptr )
+{
+    ChunkMasks masks = { 0, 0 };
+    for( u32 i = 0; i < CHUNK_SIZE / 8; ++i )
+    {
+        u64 word;
+        memcpy( &word, ptr + i * 8, sizeof(word) );
+        masks.new_lines |= match_bytes( word, '\n' ) << ( i * 8 );
+        masks.colons    |= match_bytes( word, ':' ) << ( i * 8 );
+    }
+    return masks;
+}
+
+static u64 scan_blocks_scalar( BlockScanner& scanner )
+{
+    u64 offset = 0;
+    for( ; offset + CHUNK_SIZE <= scanner.size; offset += CHUNK_SIZE )
+        add_chunk( scanner, offset, scan_chunk_scalar( scanner.data + offset ) );
+    return offset;
+}
+
+static const char* scan_new_line_scalar( const char* ptr, const char* end )
+{
+    while( ptr < end && *ptr != '\n' ) ++ptr;
+    return ptr;
+}
+
+#ifdef TEXT_SCAN_X86
+TARGET_SSE2 static ChunkMasks scan_chunk_sse2( const char* ptr )
+{
+    const __m128i new_line = _mm_set1_epi8( '\n' );
+    const __m128i colon    = _mm_set1_epi8( ':' );
+
+    ChunkMasks masks = { 0, 0 };
+    for( u32 i = 0; i < CHUNK_SIZE / 16; ++i )
+    {
+        __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( ptr + i * 16 ) );
+        masks.new_lines |= u64( (u32)_mm_movemask_epi8( _mm_cmpeq_epi8( bytes, new_line ) ) ) << ( i * 16 );
+        masks.colons    |= u64( (u32)_mm_movemask_epi8( _mm_cmpeq_epi8( bytes, colon ) ) ) << ( i * 16 );
+    }
+    return masks;
+}
+
+TARGET_SSE2 static u64 scan_blocks_sse2( BlockScanner& scanner )
+{
+    u64 offset = 0;
+    for( ; offset + CHUNK_SIZE <= scanner.size; offset += CHUNK_SIZE )
+        add_chunk( scanner, offset, scan_chunk_sse2( scanner.data + offset ) );
+    return offset;
+}
+
+TARGET_SSE2 static const char* scan_new_line_sse2( const char* ptr, const char* end )
+{
+    const __m128i new_line = _mm_set1_epi8( '\n' );
+    for( ; end - ptr >= 16; ptr += 16 )
+    {
+        __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( ptr ) );
+        u32 mask = (u32)_mm_movemask_epi8( _mm_cmpeq_epi8( bytes, new_line ) );
+        if( mask != 0 )
+            return ptr + count_trailing_zeros( mask );
+    }
+    return scan_new_line_scalar( ptr, end );
+}
+
+TARGET_AVX2 static ChunkMasks scan_chunk_avx2( const char* ptr )
+{
+    const __m256i new_line = _mm256_set1_epi8( '\n' );
+    const __m256i colon    = _mm256_set1_epi8( ':' );
+
+    __m256i low  = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( ptr ) );
+    __m256i high = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( ptr + 32 ) );
+
+    ChunkMasks masks;
+    masks.new_lines = u64( (u32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( low, new_line ) ) )
+                    | u64( (u32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( high, new_line ) ) ) << 32;
+    masks.colons    = u64( (u32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( low, colon ) ) )
+                    | u64( (u32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( high, colon ) ) ) << 32;
+    return masks;
+}
+
+TARGET_AVX2 static u64 scan_blocks_avx2( BlockScanner& scanner )
+{
+    u64 offset = 0;
+    for( ; offset + CHUNK_SIZE <= scanner.size; offset += CHUNK_SIZE )
+        add_chunk( scanner, offset, scan_chunk_avx2( scanner.data + offset ) );
+    return offset;
+}
+
+TARGET_AVX2 static const char* scan_new_line_avx2( const char* ptr, const char* end )
+{
+    const __m256i new_line = _mm256_set1_epi8( '\n' );
+    for( ; end - ptr >= 32; ptr += 32 )
+    {
+        __m256i bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( ptr ) );
+        u32 mask = (u32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( bytes, new_line ) );
+        if( mask != 0 )
+            return ptr + count_trailing_zeros( mask );
+    }
+    return scan_new_line_sse2( ptr, end );
+}
+#endif
+
+static TextScanIsa detect_text_scan_isa()
+{
+#if !defined(TEXT_SCAN_X86)
+    return TextScanIsa::SCALAR;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid( info, 0 );
+    int max_leaf = info[0];
+
+    __cpuid( info, 1 );
+    bool has_sse2 = ( info[3] & ( 1 << 26 ) ) != 0;
+    // the os has to save the ymm registers too
+    bool has_avx  = ( info[2] & ( 1 << 27 ) ) != 0 && ( info[2] & ( 1 << 28 ) ) != 0 && ( _xgetbv( 0 ) & 6 ) == 6;
+
+    bool has_avx2 = false;
+    if( has_avx && max_leaf >= 7 )
+    {
+        __cpuidex( info, 7, 0 );
+        has_avx2 = ( info[1] & ( 1 << 5 ) ) != 0;
+    }
+
+    return has_avx2 ? TextScanIsa::AVX2 : has_sse2 ? TextScanIsa::SSE2 : TextScanIsa::SCALAR;
+#else
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx2" ) )
+        return TextScanIsa::AVX2;
+    if( __builtin_cpu_supports( "sse2" ) )
+        return TextScanIsa::SSE2;
+    return TextScanIsa::SCALAR;
+#endif
+}
+
+static TextScanFunctions get_text_scan_functions( TextScanIsa isa )
+{
+    switch( isa )
+    {
+#ifdef TEXT_SCAN_X86
+    case TextScanIsa::AVX2:
+        return { isa, scan_blocks_avx2, scan_new_line_avx2 };
+    case TextScanIsa::SSE2:
+        return { isa, scan_blocks_sse2, scan_new_line_sse2 };
+#endif
+    default:
+        return { TextScanIsa::SCALAR, scan_blocks_scalar, scan_new_line_scalar };
+    }
+}
+
+static TextScanFunctions& get_text_scan_functions()
+{
+    static TextScanFunctions functions = get_text_scan_functions( detect_text_scan_isa() );
+    return functions;
+}
+
+void scan_block_headers( const char* data, u64 size, TextScan& out_scan )
+{
+    out_scan.headers.clear();
+
+    BlockScanner scanner = { data, size, out_scan, 0, 0 };
+    u64 offset = get_text_scan_functions().scan_blocks( scanner );
+
+    // the tail goes through a zero padded copy, the chunks never read past the text
+    if( offset < size )
+    {
+        char tail[CHUNK_SIZE] = {};
+        memcpy( tail, data + offset, size - offset );
+        add_chunk( scanner, offset, scan_chunk_scalar( tail ) );
+    }
+
+    out_scan.line_count = scanner.line_count + ( scanner.line_start < size ? 1 : 0 );
+}
+
+const char* scan_new_line( const char* ptr, const char* end )
+{
+    return get_text_scan_functions().scan_new_line( ptr, end );
+}
+
+TextScanIsa get_text_scan_isa()
+{
+    return get_text_scan_functions().isa;
+}
+
+TextScanIsa set_text_scan_isa( TextScanIsa isa )
+{
+    TextScanIsa supported = detect_text_scan_isa();
+    if( isa > supported )
+        isa = supported;
+
+    get_text_scan_functions() = get_text_scan_functions( isa );
+    return isa;
+}
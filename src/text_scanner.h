@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "basic_types.h"
+
+// A ':' with only spaces or tabs before it on its line, the name runs up to the next blank.
+struct ScannedBlockHeader
+{
+    const char* line;        // start of the header line
+    const char* name;        // right after the ':'
+    u32         name_length; // 0 for a lone ':'
+    const char* content;     // start of the next line, the end of the text on the last one
+    uint        line_number; // 1 based
+};
+
+struct TextScan
+{
+    std::vector<ScannedBlockHeader> headers;
+    uint line_count = 0; // a last line without '\n' counts
+};
+
+enum class TextScanIsa
+{
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// Finds every '\n' and block header in one pass over the text, 64 bytes at a time.
+void scan_block_headers( const char* data, u64 size, TextScan& out_scan );
+
+// the first '\n' in [ptr, end[, end if there is none
+const char* scan_new_line( const char* ptr, const char* end );
+
+// picked from the cpu on first use, can be lowered to compare them
+TextScanIsa get_text_scan_isa();
+TextScanIsa set_text_scan_isa( TextScanIsa isa ); // returns the one used, capped to what the cpu supports
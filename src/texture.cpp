@@ -1,5 +1,13 @@
 #include "texture.h"
 #include "file_parser.h"
+#include "dll.h"
+#include "type_db.h"
+#include "resource_loader.h"
+#include "resource_budget.h"
+#include "asset_archive.h"
+#include "decode_cache.h"
+#include "resource_dependencies.h"
+#include "load_telemetry.h"
 
 #include <GLAD/glad.h>
 
@@ -7,8 +15,20 @@
 #define STB_ASSERT
 #include <stb_image.h>
 
+REGISTER_RESOURCE_POOL( Texture );
+
+// the GPU side counts the mip chain, a third more than the base level
+static void update_texture_memory( Texture* texture, bool uploaded )
+{
+    u64 image_size = (u64)texture->size.width * (u64)texture->size.height * (u64)texture->channels;
+    set_resource_memory( texture, texture->data != nullptr ? image_size : 0, uploaded ? image_size + image_size / 3 : 0 );
+}
+
 void upload_texture( Texture* texture )
 {
+    LoadPhaseTimer upload_timer( texture->source ? resolve_string( texture->source->source ) : resolve_string( texture->name ), LoadPhase::UPLOAD );
+    upload_timer.bytes = (u64)texture->size.width * (u64)texture->size.height * (u64)texture->channels;
+
     if( texture->buffer == 0 )
         glGenTextures( 1, &texture->buffer );
 
@@ -38,14 +58,87 @@ void upload_texture( Texture* texture )
     glGenerateMipmap( GL_TEXTURE_2D );
 }
 
-Texture* find_texture( MemoryPool<Texture>& texture_pool, const char* name )
+// archived pixels are used in place, upload_texture reads them straight from the mapping
+static void free_texture_data( Texture* texture )
+{
+    if( texture->data != nullptr && !texture->borrowed_from_archive )
+        stbi_image_free( texture->data );
+
+    texture->data = nullptr;
+    texture->borrowed_from_archive = false;
+}
+
+// @Note: The const is dropped for the field only, borrowed pixels are never written or freed.
+static void assign_archived_texture( Texture* texture, const ArchiveEntry* entry )
+{
+    free_texture_data( texture );
+    texture->data = const_cast<unsigned char*>( get_archive_data( entry ) );
+    texture->size = {
+        (f32) entry->params[0],
+        (f32) entry->params[1]
+    };
+    texture->channels = (i32)entry->params[2];
+    texture->borrowed_from_archive = true;
+}
+
+#define TEXTURE_DECODE_SETTINGS 1 // stbi_load keeping the channels of the file, bump when that changes
+
+bool decode_texture( const char* file_path, DecodedTexture& decoded )
 {
-    for( auto texture : texture_pool )
+    MappedFile source;
+    u64 key;
     {
-        if( texture->name == name )
-            return texture;
+        LoadPhaseTimer read_timer( file_path, LoadPhase::READ );
+        if( !map_file( file_path, source ) )
+            return false;
+
+        // hashing touches every page, this is where the file is actually read
+        key = get_decode_cache_key( source.data, source.size, TEXTURE_DECODE_SETTINGS );
+        read_timer.bytes = source.size;
     }
-    return nullptr;
+
+    LoadPhaseTimer decode_timer( file_path, LoadPhase::DECODE );
+
+    DecodeCacheEntry entry;
+    if( open_decode_cache_entry( key, entry ) )
+    {
+        auto params = entry.header->params;
+        if( entry.header->data_size == (u64)params[0] * params[1] * params[2] )
+        {
+            // allocated like stb_image does so the texture frees it the same way
+            decoded.width    = (i32)params[0];
+            decoded.height   = (i32)params[1];
+            decoded.channels = (i32)params[2];
+            decoded.data     = (unsigned char*)STBI_MALLOC( (size_t)entry.header->data_size );
+            memcpy( decoded.data, entry.data, (size_t)entry.header->data_size );
+            close_decode_cache_entry( entry );
+            unmap_file( source );
+            return true;
+        }
+        close_decode_cache_entry( entry );
+    }
+
+    decoded.data = stbi_load_from_memory( source.data, (int)source.size, &decoded.width, &decoded.height, &decoded.channels, 0 );
+    unmap_file( source );
+    if( decoded.data == nullptr )
+        return false;
+
+    u32 params[4] = { (u32)decoded.width, (u32)decoded.height, (u32)decoded.channels, 0 };
+    write_decode_cache_entry( key, params, { { decoded.data, (u64)decoded.width * decoded.height * decoded.channels } } );
+    return true;
+}
+
+void free_decoded_texture( DecodedTexture& decoded )
+{
+    stbi_image_free( decoded.data );
+    decoded.data = nullptr;
+}
+
+Texture* find_texture( MemoryPool<Texture>& texture_pool, const char* name )
+{
+    auto& resource_pool = get_dll_appdata().global_store.resource_pool;
+    assert( &get_resource_pool<Texture>( resource_pool ) == &texture_pool, "find_texture only knows the names of the global texture pool." );
+    return find_resource<Texture>( resource_pool, name );
 }
 
 Texture* load_texture( MemoryPool<Texture>& texture_pool, const std::string& source_file )
@@ -53,39 +146,170 @@ Texture* load_texture( MemoryPool<Texture>& texture_pool, const std::string& sou
     char buffer[256];
     extract_file_name( source_file.c_str(), buffer, 256 );
     auto texture = find_texture( texture_pool, buffer );
+
+    // decoded before anything is released, a failed reload keeps the previous image
+    auto entry = find_archive_entry( source_file.c_str(), ArchiveEntryKind::TEXTURE );
+    DecodedTexture decoded;
+    if( entry == nullptr && !decode_texture( source_file.c_str(), decoded ) )
+    {
+        println( "Error: Couldn't load the texture %.", source_file.c_str() );
+        return texture;
+    }
+
     if( !texture )
     {
         texture = texture_pool.Instantiate();
-        setup_resource( texture, buffer, source_file.c_str() );
+        setup_resource( texture, source_file.c_str(), buffer );
     }
     else
     {
         cleanup_texture( *texture );
     }
 
-    i32 width, height, channels;
-    texture->data = stbi_load(source_file.c_str(), &width, &height, &channels, 0);
-    texture->size = {
-        (f32) width,
-        (f32) height
-    };
-    texture->channels = channels;
+    if( entry )
+    {
+        assign_archived_texture( texture, entry );
+    }
+    else
+    {
+        texture->data = decoded.data;
+        texture->size = {
+            (f32) decoded.width,
+            (f32) decoded.height
+        };
+        texture->channels = decoded.channels;
+    }
     upload_texture( texture );
+    update_texture_memory( texture, true );
+    texture->loaded = true;
+
+    // cleanup_texture gave back the GL name, the materials using it need the new one
+    invalidate_dependents( texture );
 
     return texture;
 }
 
-void cleanup_texture( Texture& texture )
+static void decode_texture_job( ResourceLoadJob& job )
+{
+    DecodedTexture decoded;
+    if( decode_texture( job.path.c_str(), decoded ) )
+        job.decoded = new DecodedTexture( decoded );
+}
+
+static void finalize_texture_job( ResourceLoadJob& job )
+{
+    auto decoded = static_cast<DecodedTexture*>( job.decoded );
+    auto texture = get_resource<Texture>( get_dll_appdata().global_store.resource_pool, job.resource );
+
+    if( decoded == nullptr )
+    {
+        println( "Error: Couldn't load the texture %.", job.path.c_str() );
+        return;
+    }
+
+    if( texture == nullptr )
+    {
+        free_decoded_texture( *decoded );
+    }
+    else
+    {
+        // the previous image stays displayed until the new one is there
+        free_texture_data( texture );
+
+        texture->data = decoded->data;
+        texture->size = {
+            (f32) decoded->width,
+            (f32) decoded->height
+        };
+        texture->channels = decoded->channels;
+        upload_texture( texture );
+        update_texture_memory( texture, true );
+        texture->loaded  = true;
+        texture->evicted = false;
+        invalidate_dependents( texture );
+    }
+
+    delete decoded;
+}
+
+ResourceHandle load_texture_async( MemoryPool<Texture>& texture_pool, const std::string& source_file )
 {
-    if( texture.data != nullptr )
+    char buffer[256];
+    extract_file_name( source_file.c_str(), buffer, 256 );
+    auto texture = find_texture( texture_pool, buffer );
+    if( !texture )
+    {
+        texture = texture_pool.Instantiate();
+        setup_resource( texture, source_file.c_str(), buffer );
+    }
+    texture->loaded = false;
+
+    // the GL name exists right away so materials can reference it before the upload
+    if( texture->buffer == 0 )
+        glGenTextures( 1, &texture->buffer );
+
+    // packed pixels are ready to upload, there is nothing left for a worker to do
+    if( auto entry = find_archive_entry( source_file.c_str(), ArchiveEntryKind::TEXTURE ) )
     {
-        stbi_image_free( texture.data );
+        assign_archived_texture( texture, entry );
+        upload_texture( texture );
+        update_texture_memory( texture, true );
+        texture->loaded  = true;
+        texture->evicted = false;
+        return get_resource_handle( get_dll_appdata().global_store.resource_pool, texture );
     }
 
+    ResourceLoadJob job;
+    job.resource = get_resource_handle( get_dll_appdata().global_store.resource_pool, texture );
+    job.path     = source_file;
+    job.decode   = &decode_texture_job;
+    job.finalize = &finalize_texture_job;
+    queue_resource_load( job );
+
+    return job.resource;
+}
+
+static void reload_texture( Resource* resource )
+{
+    load_texture_async( get_resource_pool<Texture>( get_dll_appdata().global_store.resource_pool ), resolve_string( resource->source->source ) );
+}
+REGISTER_RESOURCE_RELOADER( Texture, reload_texture );
+
+// releases the image and the GL texture, the resource itself stays valid
+void cleanup_texture( Texture& texture )
+{
+    free_texture_data( &texture );
+
     if( texture.buffer != 0 )
     {
         glDeleteTextures( 1, &texture.buffer );
     }
 
-    texture = {};
-}
\ No newline at end of file
+    texture.size     = { 0, 0 };
+    texture.channels = 0;
+    texture.buffer   = 0;
+    texture.loaded   = false;
+    set_resource_memory( &texture, 0, 0 );
+}
+
+// the CPU copy is only needed for the upload, dropping it doesn't change what is displayed.
+// The GPU storage is released but the GL name is kept, materials still reference it and
+// reload_texture uploads into it again on next use.
+static void evict_texture( Resource* resource, ResourceMemory memory )
+{
+    auto texture = static_cast<Texture*>( resource );
+    free_texture_data( texture );
+
+    bool uploaded = texture->gpu_size > 0;
+    if( memory == ResourceMemory::GPU && texture->buffer != 0 )
+    {
+        glBindTexture( GL_TEXTURE_2D, texture->buffer );
+        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+        texture->loaded  = false;
+        texture->evicted = true;
+        uploaded = false;
+    }
+
+    update_texture_memory( texture, uploaded );
+}
+REGISTER_RESOURCE_EVICTOR( Texture, evict_texture );
\ No newline at end of file
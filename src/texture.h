@@ -5,6 +5,7 @@
 #include "size.h"
 #include "resource.h"
 #include "memory_pool.h"
+#include "resource_pool.h"
 
 struct Texture : public Resource
 {
@@ -16,8 +17,24 @@ struct Texture : public Resource
 
     uint buffer = 0;
 };
+template<> constexpr u32 get_pool_size<Texture>() { return get_page_fitting_pool_size<Texture>(); }
+
+struct DecodedTexture
+{
+    unsigned char* data = nullptr;
+    i32 width    = 0;
+    i32 height   = 0;
+    i32 channels = 0;
+};
+
+// file io and decoding only, safe to call from a loader worker or the packer
+bool decode_texture( const char* file_path, DecodedTexture& decoded );
+void free_decoded_texture( DecodedTexture& decoded );
 
 Texture* find_texture( MemoryPool<Texture>& texture_pool, const char* name );
 void upload_texture( Texture* texture );
+// uses the asset archive when the file is packed. Returns nullptr if a first load fails,
+// a failed reload keeps the previous image.
 Texture* load_texture( MemoryPool<Texture>& texture_pool, const std::string& source_file );
+ResourceHandle load_texture_async( MemoryPool<Texture>& texture_pool, const std::string& source_file ); // loaded is set once uploaded
 void cleanup_texture( Texture& texture );
@@ -0,0 +1,55 @@
+#include "virtual_memory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// @Platform: huge pages on Windows need the SeLockMemoryPrivilege and a MEM_LARGE_PAGES
+//            reservation committed all at once, so the hint is only honored on Linux.
+
+void* reserve_virtual_memory( u64 size )
+{
+#ifdef _WIN32
+    return VirtualAlloc( nullptr, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS );
+#else
+    void* address = mmap( nullptr, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    return address == MAP_FAILED ? nullptr : address;
+#endif
+}
+
+bool commit_virtual_memory( void* address, u64 size, bool huge_pages )
+{
+#ifdef _WIN32
+    (void)huge_pages;
+    return VirtualAlloc( address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE ) != nullptr;
+#else
+    if( mprotect( address, (size_t)size, PROT_READ | PROT_WRITE ) != 0 )
+        return false;
+#ifdef MADV_HUGEPAGE
+    if( huge_pages )
+        madvise( address, (size_t)size, MADV_HUGEPAGE );
+#endif
+    return true;
+#endif
+}
+
+void decommit_virtual_memory( void* address, u64 size )
+{
+#ifdef _WIN32
+    VirtualFree( address, (SIZE_T)size, MEM_DECOMMIT );
+#else
+    madvise( address, (size_t)size, MADV_DONTNEED );
+    mprotect( address, (size_t)size, PROT_NONE );
+#endif
+}
+
+void release_virtual_memory( void* address, u64 size )
+{
+#ifdef _WIN32
+    VirtualFree( address, 0, MEM_RELEASE );
+#else
+    munmap( address, (size_t)size );
+#endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "basic_types.h"
+
+#define MEMORY_PAGE_SIZE 4096
+
+// Reserves address space without backing it with memory, returns nullptr on failure.
+void* reserve_virtual_memory( u64 size );
+
+// Backs [address, address+size[ of a reserved range with memory, address must be page aligned.
+// huge_pages is a hint, ignored where transparent huge pages aren't available.
+bool commit_virtual_memory( void* address, u64 size, bool huge_pages = false );
+
+// Gives the memory of a committed range back to the system, the range stays reserved.
+void decommit_virtual_memory( void* address, u64 size );
+
+void release_virtual_memory( void* address, u64 size );
@@ -0,0 +1,306 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <set>
+#include <vector>
+
+#include "basics.h"
+#include "memory_pool.h"
+#include "concurrent_memory_pool.h"
+#include "soa_pool.h"
+
+// Focused checks of the pool APIs no caller exercises yet, registered with ctest.
+// @Note: assert is compiled out in release, failures are counted here instead.
+
+static u32 s_failure_count = 0;
+
+#define check( Condition, Message ) \
+    do { if( !( Condition ) ) { println( "FAILED: % (%:%)", Message, __FILE__, __LINE__ ); s_failure_count++; } } while( 0 )
+
+// a blob size that isn't a multiple of 64 so the last allocation word is partial
+struct CheckElement
+{
+    u32 value;
+};
+template<> constexpr u32 get_pool_size<CheckElement>() { return 100; }
+
+static const u32 BLOB_SIZE = get_pool_size<CheckElement>();
+
+// spans stay in one blob, cover count elements once and match Get
+static void check_spans( MemoryPool<CheckElement>& pool, const std::vector<MemoryPoolSpan<CheckElement>>& spans, u32 count, std::set<u32>& live )
+{
+    u32 total = 0;
+    for( auto& span : spans )
+    {
+        check( span.count > 0, "InstantiateN returned an empty span" );
+        check( span.first_index / BLOB_SIZE == ( span.first_index + span.count - 1 ) / BLOB_SIZE, "A span crosses a blob boundary" );
+        for( u32 i = 0; i < span.count; ++i )
+        {
+            check( live.insert( span.first_index + i ).second, "InstantiateN returned a live element" );
+            check( pool.Get( span.first_index + i ) == &span[i], "A span element isn't the pool element of its index" );
+            span[i].value = span.first_index + i;
+        }
+        total += span.count;
+    }
+    check( total == count, "InstantiateN didn't return the requested count" );
+}
+
+static void check_live( MemoryPool<CheckElement>& pool, const std::set<u32>& live )
+{
+    check( pool.GetStats().live_count == (u32)live.size(), "The live count doesn't match" );
+
+    u32 iterated = 0;
+    for( CheckElement* element : pool )
+    {
+        check( live.count( element->value ) == 1, "An element is live but shouldn't be" );
+        iterated++;
+    }
+    check( iterated == (u32)live.size(), "The iterator didn't walk every live element" );
+}
+
+static void check_instantiate_n()
+{
+    MemoryPool<CheckElement> pool;
+    std::set<u32> live;
+
+    // a few singles first so the bulk claim starts in the middle of a blob
+    for( u32 i = 0; i < 30; ++i )
+    {
+        u32 idx;
+        CheckElement* element = pool.Instantiate( idx );
+        element->value = idx;
+        live.insert( idx );
+    }
+
+    u32 count = 3 * BLOB_SIZE + 17;
+    auto spans = pool.InstantiateN( count );
+    check_spans( pool, spans, count, live );
+    check( pool.GetStats().blob_count == ( 30 + count + BLOB_SIZE - 1 ) / BLOB_SIZE, "InstantiateN allocated more blobs than needed" );
+    check_live( pool, live );
+
+    // the holes are reused before new blobs are allocated
+    for( u32 idx = 5; idx < 2 * BLOB_SIZE; idx += 3 )
+    {
+        pool.DestroyByIndex( idx );
+        live.erase( idx );
+    }
+    u32 hole_count = pool.GetStats().capacity - pool.GetStats().live_count;
+    u32 blob_count = pool.GetStats().blob_count;
+    check_spans( pool, pool.InstantiateN( hole_count ), hole_count, live );
+    check( pool.GetStats().blob_count == blob_count, "InstantiateN grew the pool with free slots left" );
+    check_live( pool, live );
+
+    // destroying the spans leaves the singles
+    for( auto& span : spans )
+    {
+        for( u32 i = 0; i < span.count; ++i )
+            live.erase( span.first_index + i );
+    }
+    pool.DestroyN( spans );
+    check_live( pool, live );
+}
+
+static void check_destroy_n_range()
+{
+    MemoryPool<CheckElement> pool;
+    std::set<u32> live;
+
+    u32 count = 4 * BLOB_SIZE;
+    auto spans = pool.InstantiateN( count );
+    check_spans( pool, spans, count, live );
+
+    std::vector<PoolHandle> handles;
+    for( u32 idx = 0; idx < count; ++idx )
+        handles.push_back( pool.HandleOf( pool.Get( idx ) ) );
+
+    // from the middle of a blob to the middle of another one, whole words in between
+    u32 first_index = BLOB_SIZE / 2 + 3;
+    u32 range_count = 2 * BLOB_SIZE + 11;
+    pool.DestroyN( first_index, range_count );
+    for( u32 idx = first_index; idx < first_index + range_count; ++idx )
+        live.erase( idx );
+
+    for( u32 idx = 0; idx < count; ++idx )
+        check( pool.IsValid( handles[idx] ) == ( live.count( idx ) == 1 ), "DestroyN didn't destroy exactly its range" );
+    check_live( pool, live );
+
+    // the slots come back with new generations
+    check_spans( pool, pool.InstantiateN( range_count ), range_count, live );
+    for( u32 idx = first_index; idx < first_index + range_count; ++idx )
+        check( !pool.IsValid( handles[idx] ), "A handle destroyed by DestroyN is valid again" );
+    check_live( pool, live );
+}
+
+// a stale handle is refused in release too, the element that reused its slot survives
+static void check_stale_destroy_by_handle( MemoryPoolBase& pool )
+{
+    PoolHandle destroyed = pool.InstantiateByHandle();
+    check( pool.DestroyByHandle( destroyed ), "DestroyByHandle refused a live handle" );
+    check( !pool.DestroyByHandle( destroyed ), "DestroyByHandle accepted a handle destroyed already" );
+
+    PoolHandle reused = pool.InstantiateByHandle();
+    check( get_pool_handle_index( reused ) == get_pool_handle_index( destroyed ), "The destroyed slot wasn't reused" );
+    check( !pool.DestroyByHandle( destroyed ), "DestroyByHandle accepted a stale handle to a reused slot" );
+    check( pool.TryGetRaw( reused ) != nullptr, "A stale handle destroyed the element that reused its slot" );
+    check( pool.GetStats().live_count == 1, "A stale handle changed the live count" );
+
+    check( !pool.DestroyByHandle( make_pool_handle( 1000 * BLOB_SIZE, 1 ) ), "DestroyByHandle accepted a handle out of the pool" );
+
+    check( pool.DestroyByHandle( reused ), "DestroyByHandle refused a live handle" );
+    check( pool.GetStats().live_count == 0, "The live count is wrong after DestroyByHandle" );
+}
+
+static void check_stale_destroy_by_handle()
+{
+    MemoryPool<CheckElement> pool;
+    check_stale_destroy_by_handle( pool );
+
+    ConcurrentMemoryPool<CheckElement> concurrent_pool;
+    check_stale_destroy_by_handle( concurrent_pool );
+}
+
+struct CheckVector
+{
+    f32 x, y, z;
+};
+
+struct CheckTransform
+{
+    CheckVector position;
+    f32 scale;
+    u32 id;
+    u8  tag[3]; // no type in the metadata, the field takes the space up to the end
+};
+
+// Built by hand like gen-metadata would, the checks don't depend on the generated types.
+// @Note: Members are assigned by name so this doesn't depend on the layout of TypeInfo.
+struct CheckTypes
+{
+    TypeInfo  scalar_f32  = {};
+    TypeInfo  scalar_u32  = {};
+    TypeInfo  vector_type = {};
+    TypeInfo  transform_type = {};
+    FieldInfo vector_fields[3]    = {};
+    FieldInfo transform_fields[4] = {};
+
+    CheckTypes()
+    {
+        scalar_f32.type = TypeInfoType::Scalar;
+        scalar_f32.scalar_info.size = sizeof(f32);
+        scalar_u32.type = TypeInfoType::Scalar;
+        scalar_u32.scalar_info.size = sizeof(u32);
+
+        const char* vector_names[] = { "x", "y", "z" };
+        for( u32 i = 0; i < 3; ++i )
+        {
+            vector_fields[i].name   = vector_names[i];
+            vector_fields[i].type   = &scalar_f32;
+            vector_fields[i].offset = i * sizeof(f32);
+        }
+        vector_type.type = TypeInfoType::Struct;
+        vector_type.name = "CheckVector";
+        vector_type.struct_info.size        = sizeof(CheckVector);
+        vector_type.struct_info.field_count = 3;
+        vector_type.struct_info.fields      = vector_fields;
+
+        // declared out of order, the pool sorts them by offset
+        transform_fields[0].name   = "id";
+        transform_fields[0].type   = &scalar_u32;
+        transform_fields[0].offset = offsetof( CheckTransform, id );
+        transform_fields[1].name   = "position";
+        transform_fields[1].type   = &vector_type;
+        transform_fields[1].offset = offsetof( CheckTransform, position );
+        transform_fields[2].name   = "scale";
+        transform_fields[2].type   = &scalar_f32;
+        transform_fields[2].offset = offsetof( CheckTransform, scale );
+        transform_fields[3].name   = "tag";
+        transform_fields[3].type   = nullptr;
+        transform_fields[3].offset = offsetof( CheckTransform, tag );
+        transform_type.type = TypeInfoType::Struct;
+        transform_type.name = "CheckTransform";
+        transform_type.struct_info.size        = sizeof(CheckTransform);
+        transform_type.struct_info.field_count = 4;
+        transform_type.struct_info.fields      = transform_fields;
+    }
+};
+
+static CheckTransform make_check_transform( u32 id )
+{
+    CheckTransform transform = {};
+    transform.position = { (f32)id, (f32)id * 2.0f, 0.0f };
+    transform.scale    = 1.0f;
+    transform.id       = id;
+    transform.tag[0]   = (u8)id;
+    return transform;
+}
+
+static void check_soa_pool()
+{
+    CheckTypes types;
+    SoAPool<CheckTransform> pool( &types.transform_type );
+
+    check( pool.FieldCount() == 4, "SoAPool didn't find every member" );
+    u32 position_field = pool.FieldIndex( "position" );
+    u32 id_field       = pool.FieldIndex( "id" );
+    u32 tag_field      = pool.FieldIndex( "tag" );
+    check( position_field == 0 && pool.FieldIndex( "scale" ) == 1 && id_field == 2 && tag_field == 3, "SoAPool fields aren't sorted by offset" );
+    check( pool.GetField( position_field ).size == sizeof(CheckVector), "The size of a struct member doesn't come from its type" );
+    check( pool.GetField( tag_field ).size == sizeof(CheckTransform) - offsetof( CheckTransform, tag ), "A member without type doesn't take the space up to the end" );
+
+    const u32 count = 1000;
+    std::vector<PoolHandle> handles;
+    for( u32 i = 0; i < count; ++i )
+        handles.push_back( pool.Instantiate( make_check_transform( i ) ) );
+
+    // swap-remove moves the last elements into the holes, their handles must follow
+    for( u32 i = 0; i < count; i += 2 )
+        pool.Destroy( handles[i] );
+    check( pool.Count() == count / 2, "SoAPool count is wrong after Destroy" );
+
+    for( CheckVector& position : pool.Field<CheckVector>( position_field ) )
+        position.z = position.x + position.y;
+
+    for( u32 i = 0; i < count; ++i )
+    {
+        bool live = i % 2 == 1;
+        check( pool.IsValid( handles[i] ) == live, "A SoAPool handle has the wrong validity" );
+        if( !live )
+            continue;
+
+        CheckTransform transform = pool.Get( handles[i] );
+        check( transform.id == i && transform.position.x == (f32)i && transform.tag[0] == (u8)i, "A SoAPool element lost its values" );
+        check( transform.position.z == (f32)i * 3.0f, "A write through a field span was lost" );
+    }
+
+    // dense access and proxy writes
+    for( u32 dense_idx = 0; dense_idx < pool.Count(); ++dense_idx )
+    {
+        PoolHandle handle = pool.HandleAt( dense_idx );
+        check( pool.IsValid( handle ), "HandleAt returned a stale handle" );
+        pool[ dense_idx ].field<u32>( id_field ) += count;
+        check( pool.Get( handle ).load().id == pool.Field<u32>( id_field )[ dense_idx ], "The proxy and the field array disagree" );
+    }
+
+    // reused slots get new generations
+    for( u32 i = 0; i < count / 2; ++i )
+        pool.Instantiate( make_check_transform( i ) );
+    check( pool.Count() == count, "SoAPool count is wrong after reusing the slots" );
+    for( u32 i = 0; i < count; i += 2 )
+        check( !pool.IsValid( handles[i] ), "A destroyed SoAPool handle is valid again" );
+}
+
+int main()
+{
+    check_instantiate_n();
+    check_destroy_n_range();
+    check_stale_destroy_by_handle();
+    check_soa_pool();
+
+    if( s_failure_count > 0 )
+    {
+        println( "Failed checks: %", s_failure_count );
+        return 1;
+    }
+
+    println( "All pool checks passed." );
+    return 0;
+}
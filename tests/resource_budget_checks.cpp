@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <vector>
+
+#include "basics.h"
+#include "dll.h"
+#include "resource.h"
+#include "resource_pool.h"
+#include "resource_budget.h"
+
+// Checks of the eviction order of the resource budget, registered with ctest.
+// Runs on the default appdata of the dll, no window or GL context is created.
+// @Note: assert is compiled out in release, failures are counted here instead.
+
+static u32 s_failure_count = 0;
+
+#define check( Condition, Message ) \
+    do { if( !( Condition ) ) { println( "FAILED: % (%:%)", Message, __FILE__, __LINE__ ); s_failure_count++; } } while( 0 )
+
+// plain Resources have no evictor in the dll, this one only records the evictions
+static std::vector<Resource*> s_evicted;
+static void evict_check_resource( Resource* resource, ResourceMemory memory )
+{
+    s_evicted.push_back( resource );
+    set_resource_memory( resource, 0, resource->gpu_size );
+    resource->evicted = true;
+}
+REGISTER_RESOURCE_EVICTOR( Resource, evict_check_resource );
+
+static bool was_evicted( const Resource* resource )
+{
+    for( auto evicted : s_evicted )
+    {
+        if( evicted == resource )
+            return true;
+    }
+    return false;
+}
+
+// the least recently used resource is kept while it is referenced, the next ones go instead
+static void check_referenced_resource_is_kept()
+{
+    auto& appdata = get_dll_appdata();
+    auto source = appdata.global_store.resource_sources_pool.Instantiate();
+
+    const u32 RESOURCE_COUNT = 4;
+    Resource resources[RESOURCE_COUNT];
+    for( u32 i = 0; i < RESOURCE_COUNT; ++i )
+    {
+        resources[i].source = source;
+        resources[i].loaded = true;
+        source->resources.push_back( &resources[i] );
+        set_resource_memory( &resources[i], 100, 0 );
+    }
+
+    // the referenced one is the oldest, the frame moves on so none of them is used this frame
+    appdata.app_state.global_frame_count = 1;
+    acquire_resource( &resources[0] );
+    for( u32 i = 1; i < RESOURCE_COUNT; ++i )
+    {
+        appdata.app_state.global_frame_count++;
+        use_resource( &resources[i] );
+    }
+    appdata.app_state.global_frame_count += 2;
+
+    set_resource_budget( 250, DEFAULT_RESOURCE_GPU_BUDGET );
+    enforce_resource_budget();
+
+    check( !was_evicted( &resources[0] ), "A referenced resource was evicted" );
+    check( was_evicted( &resources[1] ) && was_evicted( &resources[2] ), "The least recently used unreferenced resources weren't evicted" );
+    check( !was_evicted( &resources[3] ), "More resources than needed were evicted" );
+    check( appdata.global_store.resource_budget.cpu_usage <= 250, "The usage doesn't fit the budget after the evictions" );
+
+    // once released it is the first to go
+    release_resource( &resources[0] );
+    s_evicted.clear();
+    set_resource_budget( 50, DEFAULT_RESOURCE_GPU_BUDGET );
+    enforce_resource_budget();
+    check( was_evicted( &resources[0] ), "A released resource wasn't evicted" );
+
+    // nothing can be evicted while everything is referenced, the budget is exceeded instead
+    for( u32 i = 0; i < RESOURCE_COUNT; ++i )
+    {
+        resources[i].evicted = false;
+        set_resource_memory( &resources[i], 100, 0 );
+        acquire_resource( &resources[i] );
+    }
+    s_evicted.clear();
+    appdata.app_state.global_frame_count += 2;
+    enforce_resource_budget();
+    check( s_evicted.empty(), "A referenced resource was evicted over budget" );
+
+    for( u32 i = 0; i < RESOURCE_COUNT; ++i )
+    {
+        release_resource( &resources[i] );
+        set_resource_memory( &resources[i], 0, 0 );
+    }
+    source->resources.clear();
+    appdata.global_store.resource_sources_pool.Destroy( source );
+    set_resource_budget( DEFAULT_RESOURCE_CPU_BUDGET, DEFAULT_RESOURCE_GPU_BUDGET );
+}
+
+int main()
+{
+    check_referenced_resource_is_kept();
+
+    if( s_failure_count > 0 )
+    {
+        println( "Failed checks: %", s_failure_count );
+        return 1;
+    }
+
+    println( "All resource budget checks passed." );
+    return 0;
+}